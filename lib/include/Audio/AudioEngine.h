@@ -2,6 +2,7 @@
 #define __AUDIOENGINE_H_
 
 #include "./Backend/miniaudio.h"
+#include <Threads/ThreadOptions.h>
 #include <filesystem>
 #include <vector>
 #include <memory>
@@ -26,6 +27,10 @@ namespace Audio {
 
         ma_context* GetContext();
 
+        // Taken by each device thread on its first callback, set before streams start playing
+        void SetThreadOptions(ThreadOptions options);
+        const ThreadOptions& GetThreadOptions();
+
         static Engine* Get();
         static void Destroy();
     private:
@@ -38,6 +43,7 @@ namespace Audio {
         std::vector<std::unique_ptr<Sample>> m_Samples;
 
         ma_context m_Context;
+        ThreadOptions m_ThreadOptions;
     };
 }
 
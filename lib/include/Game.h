@@ -1,18 +1,33 @@
 #ifndef __GAME_H__
 #define __GAME_H__
 #include "Threads/Thread.h"
+#include "Threads/ThreadOptions.h"
 #include "UI/Text.h"
 #include <Graphics/NativeWindow.h>
 #include <Graphics/Renderer.h>
 #include <Math/Vector2.h>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 enum class ThreadMode {
     Single,
     Multi
 };
 
+// One step of Run getting the game up, in seconds since Run was called
+struct StartupPhase
+{
+    std::string     name;
+    std::thread::id thread;
+    double          begin = 0.0;
+    double          end = 0.0;
+};
+
 struct RunInfo
 {
     std::string                  title;
@@ -21,6 +36,55 @@ struct RunInfo
     ThreadMode                   threadMode;
     Graphics::TextureSamplerInfo samplerInfo;
     Graphics::API                graphics;
+    Graphics::IdleMode           idleMode = Graphics::IdleMode::Always;
+
+    Graphics::Backends::VertexFormat vertexFormat = Graphics::Backends::VertexFormat::Float;
+
+    // Use Graphics::Backends::SwapchainInfo::LowLatency() when input-to-photon latency matters most
+    Graphics::Backends::SwapchainInfo swapchain;
+
+    // Vulkan records draws on them, Software rasterizes tiles. 0 leaves it to the backend:
+    // Software uses every core, Vulkan one as it needs thousands of submissions per frame before more pay off
+    uint32_t recordThreads = 0;
+
+    // JobSystem workers, 0 leaves a core each to the render, input and audio threads
+    uint32_t jobThreads = 0;
+
+    // Calls OnUpdate at this rate with a fixed delta, 0 calls it once per frame with the measured one
+    // OnDraw then gets how far the frame is between the last two updates, to interpolate with
+    double fixedUpdateRate = 0.0;
+
+    // Updates a frame may run to catch up, time beyond that is dropped instead of slowing down further
+    uint32_t maxUpdateSteps = 5;
+
+    // Multi mode frames per second, 0 follows the refresh rate of the window's display, 60 when unknown
+    // With a Fifo swapchain the present waits for vblank itself, lower rates are rounded to a divisor of the refresh rate
+    // A frame running late skips the slots it missed instead of rushing the next ones out
+    double frameRate = 0.0;
+
+    // Multi mode, the input thread sleeps in SDL until an event arrives instead of polling at inputRate
+    bool waitForEvents = true;
+
+    // Most OnInput calls per second, and the polling rate of single mode or without waitForEvents
+    double inputRate = 1000.0;
+
+    // Fewest OnInput calls per second while waiting for events, for state polled with IsKeyDown and the like
+    double inputIdleRate = 60.0;
+
+    // Names, CPU masks and priorities of the engine threads, the input thread is the one calling Run
+    // It is left unnamed, naming the main thread renames the process in ps, top and killall
+    // Audio applies to the device threads miniaudio creates, on their first callback
+    ThreadOptions drawThread = { "est-draw" };
+    ThreadOptions updateThread = { "est-update" };
+    ThreadOptions inputThread = {};
+    ThreadOptions audioThread = { "est-audio" };
+
+    // Multi mode only, OnUpdate and OnDraw build frame N+1 on an update thread while the draw thread renders frame N
+    // Costs a frame of latency, see Graphics::Renderer::SetPipelined
+    bool pipelined = false;
+
+    // Prints the startup phases to stdout once OnLoad returned, see Game::GetStartupPhases
+    bool logStartup = false;
 };
 
 class Game
@@ -49,26 +113,71 @@ protected:
     /*
      * Called when the game should update the input
      * You might want to use this to update the input state like keyboard and mouse
+     * Runs as soon as events arrive with RunInfo::waitForEvents, otherwise at RunInfo::inputRate
      * Thread: Window
      */
     virtual void OnInput(double delta);
 
     /**
      * Called when the game should update
-     * Thread: Render
+     * Inputs::Manager::IsKeyPressed and the like report the edges since the previous update
+     * delta is 1 / RunInfo::fixedUpdateRate when set, and it may run several times or not at all per frame
+     * Thread: Render, Update when RunInfo::pipelined is set
      */
     virtual void OnUpdate(double delta);
 
     /**
      * Called when the game should draw
      * it might not be called every frame like window minimized
-     * Thread: Render
+     * Thread: Render, Update when RunInfo::pipelined is set
      */
     virtual void OnDraw(double delta);
 
+    /**
+     * Called when the game should draw, in place of OnDraw(delta) which it calls unless overridden
+     * alpha is how far this frame is from the last OnUpdate towards the next one, from 0 to 1
+     * Draw previous + (current - previous) * alpha to move smoothly at any frame rate
+     * alpha is always 1 without RunInfo::fixedUpdateRate
+     * Thread: Render, Update when RunInfo::pipelined is set
+     */
+    virtual void OnDraw(double delta, double alpha);
+
+    /**
+     * Deadline error of the loop calling it, the draw or update loop from OnUpdate and OnDraw, the input loop from OnInput
+     * Single threaded mode runs everything on the input loop
+     */
+    TimeWatch::Jitter GetTickJitter();
+
+    /**
+     * Startup phases so far in the order they finished, phases on different threads overlap
+     * The audio context connects while the window and renderer are created, pipelines compile on the JobSystem
+     */
+    std::vector<StartupPhase> GetStartupPhases();
+
 private:
+    // Runs the OnUpdate calls of one frame, returns the interpolation alpha for OnDraw
+    double Update(double delta);
+
+    void TimePhase(const char *name, const std::function<void()> &function);
+    void PrintStartupPhases();
+
+    std::chrono::steady_clock::time_point m_StartTime;
+    std::vector<StartupPhase>             m_StartupPhases;
+    std::mutex                            m_StartupMutex;
+
+    // Tick rate of the loop producing frames, just over the refresh rate when a vsync'd present paces it
+    double GetDrawRate();
+
+    double   m_FixedStep = 0.0;
+    double   m_Accumulator = 0.0;
+    uint32_t m_MaxUpdateSteps = 5;
+
+    double m_FrameRate = 0.0;
+    bool   m_PresentPaced = false;
+
     Thread m_InputThread;
     Thread m_DrawThread;
+    Thread m_UpdateThread;
 
     std::unique_ptr<UI::Text> rect;
 };
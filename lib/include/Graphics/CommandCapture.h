@@ -0,0 +1,66 @@
+#ifndef __COMMANDCAPTURE_H_
+#define __COMMANDCAPTURE_H_
+
+#include "GraphicsBackendBase.h"
+#include <filesystem>
+#include <map>
+#include <vector>
+
+namespace Graphics {
+    /*
+        Submissions as they reached the backend over a few frames, see Renderer::RecordCommands
+        Textures and blend states are referenced by hash, texture pixels are not stored: a replay
+        draws placeholders of the same size, which costs the GPU the same to sample.
+    */
+    struct CommandCapture
+    {
+        struct Texture
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            bool     opaque = false;
+        };
+
+        // Builtin states are the backend's DefaultBlend handles, only the handle is kept
+        struct Blend
+        {
+            bool                       builtin = true;
+            Backends::BlendHandle      handle = Backends::DefaultBlend::NONE;
+            Backends::TextureBlendInfo info = {};
+        };
+
+        struct Submission
+        {
+            // info.image is null and info.alphablend is meaningless, the fields below replace them
+            Backends::SubmitInfo info;
+
+            Backends::RenderTargetHandle target = Backends::kBackbuffer;
+
+            // Key in textures, 0 when image is not a texture loaded through the Renderer
+            uint64_t imageHash = 0;
+
+            // Render target sampled as image, kBackbuffer when none
+            Backends::RenderTargetHandle imageTarget = Backends::kBackbuffer;
+
+            // Key in blends
+            uint64_t blendHash = 0;
+        };
+
+        struct Frame
+        {
+            int                     width = 0;
+            int                     height = 0;
+            std::vector<Submission> submissions;
+        };
+
+        std::map<uint64_t, Texture>                  textures;
+        std::map<uint64_t, Blend>                    blends;
+        std::map<Backends::RenderTargetHandle, Rect> targets;
+        std::vector<Frame>                           frames;
+
+        void                  Write(std::filesystem::path path) const;
+        static CommandCapture Read(std::filesystem::path path);
+    };
+} // namespace Graphics
+
+#endif
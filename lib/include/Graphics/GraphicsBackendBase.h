@@ -2,11 +2,15 @@
 #define __GRAPHICSBACKENDBASE_H_
 
 #include "Utils/Rect.h"
+#include <cmath>
 #include <glm/glm.hpp>
+#include <utility>
 #include <vector>
 
 #define MY_OFFSETOF(TYPE, ELEMENT) ((size_t) & (((TYPE *)0)->ELEMENT))
 
+struct ImDrawData;
+
 namespace Graphics {
     namespace Backends {
         struct Vertex
@@ -36,12 +40,92 @@ namespace Graphics {
             };
         };
 
+        enum class VertexFormat {
+            Float = 0,   // Vertex as is, 20 bytes
+            Compact = 1, // CompactVertex, 12 bytes
+        };
+
+        // Positions in 1/8 px as snorm16 (-4096..4096 px, Renderer::Push moves farther submissions around 0), unorm16 UVs clamped to 0..1, RGBA8 color
+        struct CompactVertex
+        {
+            int16_t  pos[2];
+            uint16_t texCoord[2];
+            uint32_t color;
+        };
+
+        const float kCompactSubpixels = 8.0f;
+        const float kCompactRange = 32767.0f / kCompactSubpixels;
+
+        // snorm16 reaches the shader as value / 32767, the push constant scales positions back by this
+        const float kCompactPositionUnit = kCompactSubpixels / 32767.0f;
+
+        inline CompactVertex ToCompactVertex(const Vertex &vertex)
+        {
+            auto position = [](float value) {
+                float scaled = value * kCompactSubpixels;
+                scaled = scaled < -32767.0f ? -32767.0f : (scaled > 32767.0f ? 32767.0f : scaled);
+                return (int16_t)std::lrint(scaled);
+            };
+
+            auto texCoord = [](float value) {
+                value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+                return (uint16_t)(value * 65535.0f + 0.5f);
+            };
+
+            CompactVertex compact;
+            compact.pos[0] = position(vertex.pos.x);
+            compact.pos[1] = position(vertex.pos.y);
+            compact.texCoord[0] = texCoord(vertex.texCoord.x);
+            compact.texCoord[1] = texCoord(vertex.texCoord.y);
+            compact.color = vertex.color;
+
+            return compact;
+        }
+
+        enum class PresentMode {
+            Fifo = 0,      // Vsync, never tears
+            Mailbox = 1,   // Vsync, newest frame replaces the queued one, falls back to Fifo
+            Immediate = 2, // No vsync, may tear, falls back to Mailbox then Fifo
+        };
+
+        struct SwapchainInfo
+        {
+            PresentMode presentMode = PresentMode::Fifo;
+
+            // Minimum swapchain images, 0 lets the driver decide
+            uint32_t imageCount = 0;
+
+            // Frames the CPU may record ahead of the GPU, at least 1
+            uint32_t framesInFlight = 2;
+
+            // Block until the previous frame finished on the GPU before input is sampled
+            bool waitForPresent = false;
+
+            // Render offscreen at the window size without presenting, for benchmarks and CI without a display
+            bool headless = false;
+
+            static SwapchainInfo LowLatency()
+            {
+                SwapchainInfo info;
+                info.presentMode = PresentMode::Mailbox;
+                info.imageCount = 3;
+                info.framesInFlight = 1;
+                info.waitForPresent = true;
+
+                return info;
+            }
+        };
+
         enum class ShaderFragmentType {
             Solid,
             Image
         };
 
         typedef uint32_t BlendHandle;
+        typedef uint32_t RenderTargetHandle;
+
+        // Push() goes to the window when this target is active
+        const RenderTargetHandle kBackbuffer = 0;
 
         struct SubmitInfo
         {
@@ -56,8 +140,33 @@ namespace Graphics {
             const void        *image = NULL;
             ShaderFragmentType fragmentType;
             BlendHandle        alphablend;
+
+            // Every texel of image has full alpha
+            bool opaqueImage = false;
+
+            // Applied by the vertex shader: matrix * (pos - pivot) + pivot + offset
+            // transform holds the columns of the 2x2 matrix
+            glm::vec4 transform = { 1.0f, 0.0f, 0.0f, 1.0f };
+            glm::vec2 pivot = { 0.0f, 0.0f };
+            glm::vec2 offset = { 0.0f, 0.0f };
+        };
+
+        // Specialization constant of image.frag and solid.frag, picked per submission
+        enum class ShaderVariant {
+            Square = 0,  // No corner radius: no corner math, no discard
+            Rounded = 1, // Rounded-box SDF
         };
 
+        inline ShaderVariant GetShaderVariant(const SubmitInfo &info)
+        {
+            auto &radius = info.uiRadius;
+            bool  rounded = radius.x > 0.0f || radius.y > 0.0f || radius.z > 0.0f || radius.w > 0.0f;
+
+            return rounded ? ShaderVariant::Rounded : ShaderVariant::Square;
+        }
+
+        typedef std::pair<ShaderFragmentType, ShaderVariant> ShaderKey;
+
         enum class BlendFactor {
             BLEND_FACTOR_ZERO = 0,
             BLEND_FACTOR_ONE = 1,
@@ -104,18 +213,71 @@ namespace Graphics {
         };
 
         namespace DefaultBlend {
-            const BlendHandle NONE = 0;  // no blending
-            const BlendHandle BLEND = 1; // dstRGB = (srcRGB * srcA) + (dstRGB * (1-srcA)), dstA = srcA + (dstA * (1-srcA))
-            const BlendHandle ADD = 2;   // dstRGB = (srcRGB * srcA) + dstRGB, dstA = dstA
-            const BlendHandle MOD = 3;   // dstRGB = srcRGB * dstRGB, dstA = dstA
-            const BlendHandle MUL = 4;   // dstRGB = (srcRGB * dstRGB) + (dstRGB * (1-srcA)), dstA = (srcA * dstA) + (dstA * (1-srcA))
-        }                                // namespace DefaultBlend
+            const BlendHandle NONE = 0;          // no blending
+            const BlendHandle BLEND = 1;         // dstRGB = (srcRGB * srcA) + (dstRGB * (1-srcA)), dstA = srcA + (dstA * (1-srcA))
+            const BlendHandle ADD = 2;           // dstRGB = (srcRGB * srcA) + dstRGB, dstA = dstA
+            const BlendHandle MOD = 3;           // dstRGB = srcRGB * dstRGB, dstA = dstA
+            const BlendHandle MUL = 4;           // dstRGB = (srcRGB * dstRGB) + (dstRGB * (1-srcA)), dstA = (srcA * dstA) + (dstA * (1-srcA))
+            const BlendHandle PREMULTIPLIED = 5; // dstRGB = srcRGB + (dstRGB * (1-srcA)), dstA = srcA + (dstA * (1-srcA)), for colors already multiplied by alpha
+        }                                        // namespace DefaultBlend
+
+        /*
+            Opaque submissions are drawn first, front-to-back with depth writes, using DefaultBlend::NONE.
+            Everything else is blended back-to-front afterwards, depth tested against them.
+        */
+        inline bool IsOpaque(const SubmitInfo &info)
+        {
+            if (info.alphablend == DefaultBlend::NONE) {
+                return true;
+            }
+
+            if (info.alphablend != DefaultBlend::BLEND || GetShaderVariant(info) != ShaderVariant::Square) {
+                return false;
+            }
+
+            if (info.fragmentType == ShaderFragmentType::Image && !info.opaqueImage) {
+                return false;
+            }
+
+            for (auto &vertex : info.vertices) {
+                if ((vertex.color >> 24) != 0xFF) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Later submissions in a sorted queue are nearer, depth stays strictly inside (0, 1)
+        inline float GetSubmissionDepth(size_t index, size_t count)
+        {
+            return 1.0f - (float)(index + 1) / (float)(count + 1);
+        }
+
+        /*
+            GPU time of one frame's passes in milliseconds
+            Read back from a frame that already completed, so it trails the current frame by the frames in flight.
+        */
+        struct GpuTimings
+        {
+            // False until a frame was measured, or when the device can't time its work
+            bool valid = false;
+
+            double targets = 0.0; // Offscreen render targets
+            double main = 0.0;    // Main pass submissions
+            double imgui = 0.0;   // ImGui, drawn last in the main pass
+            double total = 0.0;   // All of the above
+        };
 
         class Base
         {
         public:
             virtual ~Base() = default;
 
+            // Must be called before Init()
+            virtual void SetVertexFormat(VertexFormat format) = 0;
+            virtual void SetSwapchainInfo(SwapchainInfo info) = 0;
+
             virtual void Init() = 0;
             virtual void ReInit() = 0;
             virtual void Shutdown() = 0;
@@ -125,6 +287,9 @@ namespace Graphics {
             virtual bool BeginFrame() = 0;
             virtual void EndFrame() = 0;
 
+            // Blocks until the last submitted frame finished rendering
+            virtual void WaitForPresent() = 0;
+
             virtual void ImGui_Init() = 0;
             virtual void ImGui_DeInit() = 0;
             virtual void ImGui_NewFrame() = 0;
@@ -137,6 +302,37 @@ namespace Graphics {
             virtual void SetClearStencil(uint32_t stencil) = 0;
 
             virtual BlendHandle CreateBlendState(TextureBlendInfo blendInfo) = 0;
+
+            /*
+                Offscreen render targets
+                Rect is the window-space region the target covers, submissions pushed while
+                the target is active are rendered into it at EndFrame, before the backbuffer.
+                A target that receives no submissions in a frame keeps its previous content.
+            */
+            virtual RenderTargetHandle CreateRenderTarget(Rect rect) = 0;
+            virtual void               DestroyRenderTarget(RenderTargetHandle handle) = 0;
+            virtual void               SetRenderTarget(RenderTargetHandle handle) = 0;
+            virtual const void        *GetRenderTargetImage(RenderTargetHandle handle) = 0;
+
+            /*
+                Idle presentation, called right after BeginFrame with a hash of the frame content.
+                Returns true when the acquired image already shows that frame and was presented as is,
+                otherwise the frame has to be recorded as usual and the image is tagged with the hash.
+            */
+            virtual bool Represent(uint64_t hash) = 0;
+
+            // Threads recording draw commands, 0 picks the backend's default, backends without support record on one
+            virtual void SetRecordThreads(uint32_t threads) = 0;
+
+            // The next EndFrame keeps a copy of the frame, RGBA8 top row first, for ReadCapture
+            virtual void RequestCapture() = 0;
+            virtual bool ReadCapture(std::vector<uint8_t> &pixels, int &width, int &height) = 0;
+
+            // Latest measured frame, never waits on the GPU
+            virtual GpuTimings GetGpuTimings() = 0;
+
+            // What EndFrame draws for ImGui instead of ImGui::GetDrawData(), nullptr goes back to it
+            virtual void SetImGuiDrawData(ImDrawData *data) = 0;
         };
     } // namespace Backends
 } // namespace Graphics
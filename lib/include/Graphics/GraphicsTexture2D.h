@@ -65,9 +65,25 @@ namespace Graphics {
 
         virtual const void *GetId() = 0;
 
+        // Every pixel has full alpha, lets the renderer draw it in the opaque pass
+        bool IsOpaque() { return Opaque; }
+
     protected:
+        static bool IsOpaquePixels(const char *pixbuf, uint32_t width, uint32_t height)
+        {
+            size_t size = (size_t)width * (size_t)height * 4;
+            for (size_t i = 3; i < size; i += 4) {
+                if ((unsigned char)pixbuf[i] != 0xFF) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
         std::filesystem::path Path;
         TextureSamplerInfo    SamplerInfo;
+        bool                  Opaque = false;
     };
 } // namespace Graphics
 
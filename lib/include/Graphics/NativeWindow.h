@@ -1,6 +1,7 @@
 #ifndef __NATIVE_WINDOW_H__
 #define __NATIVE_WINDOW_H__
 
+#include <atomic>
 #include <string>
 #include <memory>
 #include <functional>
@@ -25,14 +26,22 @@ namespace Graphics
     class NativeWindow
     {
     public:
-        void Init(std::string title, int width, int height, API graphics, bool fullscreen);
+        // Headless windows stay hidden and carry no Vulkan surface support, see Backends::SwapchainInfo::headless
+        void Init(std::string title, int width, int height, API graphics, bool fullscreen, bool headless = false);
 
         void PumpEvents();
         bool ShouldExit();
 
+        // Blocks until an event arrives or timeout seconds passed, then dispatches everything queued
+        // Returns false on timeout
+        bool WaitEvents(double timeout);
+
         Rect GetWindowSize();
         void SetWindowSize(Rect size);
 
+        // Refresh rate of the display showing the window, 0 when unknown, follows the window between displays
+        double GetRefreshRate();
+
         SDL_Window* GetWindow();
 
         void AddSDLCallback(std::function<void(SDL_Event&)> callback);
@@ -45,7 +54,11 @@ namespace Graphics
 
         static NativeWindow* s_Instance;
 
+        void DispatchEvent(SDL_Event& event);
+        void UpdateRefreshRate();
+
         bool m_ShouldExit = false;
+        std::atomic<double> m_RefreshRate{ 0.0 };
         Rect m_WindowRect;
         std::vector<std::function<void(SDL_Event&)>> m_Callbacks;
         std::unique_ptr<SDL_Window, SDLWindowSmartDeallocator> m_Window;
@@ -1,29 +1,59 @@
 #ifndef __RENDERER_H__
 #define __RENDERER_H__
 
+#include "CommandCapture.h"
 #include "GraphicsBackendBase.h"
 #include "GraphicsTexture2D.h"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace Graphics {
     enum class API {
         None = 0,
         OpenGL = 1,
         Vulkan = 2,
+        Software = 3,
+    };
+
+    enum class IdleMode {
+        // Record and present every frame
+        Always = 0,
+        // Skip recording and present when the frame did not change
+        SkipUnchanged = 1,
+        // Re-present the previous image when the frame did not change
+        Represent = 2,
     };
 
     class Renderer
     {
     public:
-        void Init(API api, TextureSamplerInfo sampler);
+        void Init(API api, TextureSamplerInfo sampler, Backends::VertexFormat vertexFormat = Backends::VertexFormat::Float, Backends::SwapchainInfo swapchain = {});
 
         bool BeginFrame();
         void EndFrame();
 
+        // No-op unless SwapchainInfo::waitForPresent is set, call it right before sampling input
+        void WaitForPresent();
+
+        // Incremented by every BeginFrame, used to cache per-frame state
+        uint64_t GetFrameIndex();
+
         void ImGui_NewFrame();
         void ImGui_EndFrame();
 
-        void Push(Graphics::Backends::SubmitInfo &info);
+        // GPU time of a recent frame, see Backends::GpuTimings
+        Backends::GpuTimings GetGpuTimings();
+
+        // Shows GetGpuTimings() in a corner window, drawn by ImGui_EndFrame
+        void SetGpuTimingsOverlay(bool enabled);
+
+        // Submissions entirely outside their clip rect or the viewport are dropped here
+        void     Push(Graphics::Backends::SubmitInfo &info);
+        uint64_t GetCulledSubmissions();
 
         Backends::Base *GetBackend();
         API             GetAPI();
@@ -38,8 +68,63 @@ namespace Graphics {
         Texture2D *LoadTexture(const char *buf, size_t size);
         Texture2D *LoadTexture(const char *pixbuf, uint32_t width, uint32_t height);
 
+        // Called by texture destructors, the id may be handed to the next texture
+        void UnregisterTexture(const void *id);
+
         Graphics::Backends::BlendHandle CreateBlendState(Graphics::Backends::TextureBlendInfo info);
 
+        /*
+            Render targets
+            Everything pushed while a target is active goes to it instead of the window
+            origin is taken off everything pushed to the target, content drawn at any position fits a target made at 0, 0
+        */
+
+        Graphics::Backends::RenderTargetHandle CreateRenderTarget(Rect rect);
+        void                                   DestroyRenderTarget(Graphics::Backends::RenderTargetHandle handle);
+        void                                   SetRenderTarget(Graphics::Backends::RenderTargetHandle handle, glm::vec2 origin = glm::vec2(0.0f));
+        Graphics::Backends::RenderTargetHandle GetRenderTarget();
+        glm::vec2                              GetRenderTargetOrigin();
+        const void                            *GetRenderTargetImage(Graphics::Backends::RenderTargetHandle handle);
+
+        /*
+            Idle frames
+            Outside of IdleMode::Always the frame is hashed at EndFrame and only reaches the backend when it changed.
+            Textures are compared by handle, call Invalidate() after updating one in place.
+        */
+
+        void     SetIdleMode(IdleMode mode);
+        IdleMode GetIdleMode();
+
+        // See Backends::Base::SetRecordThreads
+        void SetRecordThreads(uint32_t threads);
+
+        // Writes the next rendered frame to path as PNG, Vulkan only supports it with SwapchainInfo::headless
+        void CaptureFrame(std::string path);
+
+        // Writes the submissions of the next frames to path as a CommandCapture, for tools/replay
+        // Textures loaded after this call are identified by their pixels, earlier ones by load order
+        void RecordCommands(std::string path, uint32_t frames = 1);
+
+        /*
+            Pipelined frames
+            The thread enabling it becomes the render thread and owns the backend, BeginFrame/Push/EndFrame on
+            another thread only build a list that RenderPending() records and presents while the next one is built.
+            EndFrame waits for the previous frame, so there is one frame being built and one being rendered.
+            Texture loads, render targets and other backend calls from the building thread run on the render thread
+            through Invoke, between two frames.
+        */
+        void SetPipelined(bool enabled);
+        bool IsPipelined();
+
+        // Render thread only, runs queued frames and Invoke calls, waiting up to timeout seconds for the first
+        void RenderPending(double timeout);
+
+        // Runs function on the render thread and waits for it, directly when not pipelined or already there
+        void Invoke(std::function<void()> function);
+
+        void     Invalidate();
+        uint64_t GetSkippedFrames();
+
         static Renderer *Get();
         static void      Destroy();
 
@@ -48,11 +133,81 @@ namespace Graphics {
 
         ~Renderer();
 
-        API                m_API;
+        API                m_API = API::None;
         TextureSamplerInfo m_Sampler;
 
-        Backends::Base *m_Backend;
+        Backends::Base *m_Backend = nullptr;
         bool            m_onFrame = false;
+
+        Backends::SwapchainInfo m_Swapchain;
+        Backends::VertexFormat  m_VertexFormat = Backends::VertexFormat::Float;
+
+        Graphics::Backends::RenderTargetHandle m_RenderTarget = Graphics::Backends::kBackbuffer;
+        glm::vec2                              m_RenderTargetOrigin = glm::vec2(0.0f);
+
+        std::map<Graphics::Backends::RenderTargetHandle, Rect> m_TargetRects;
+        Rect                                                   m_Viewport = {};
+        uint64_t                                               m_CulledSubmissions = 0;
+
+        // Held until EndFrame when idle frames or pipelining are enabled, each submission remembers its target
+        struct FrameList
+        {
+            std::vector<Graphics::Backends::SubmitInfo>         submissions;
+            std::vector<Graphics::Backends::RenderTargetHandle> targets;
+            std::vector<Graphics::Backends::RenderTargetHandle> activations;
+
+            Rect     viewport = {};
+            uint64_t generation = 0;
+
+            // Content of every target as of this frame, a target keeps what was drawn into it in earlier frames
+            std::vector<std::pair<Graphics::Backends::RenderTargetHandle, uint64_t>> targetGenerations;
+        };
+
+        // Everything the render thread shares with the building thread, see SetPipelined
+        struct Pipeline;
+
+        bool     IsBuffered();
+        uint64_t HashFrame(const FrameList &frame, ImDrawData *imgui);
+        void     FlushFrame(FrameList &frame);
+        void     DiscardFrame(FrameList &frame);
+        void     PresentFrame(FrameList &frame, ImDrawData *imgui);
+        void     QueueFrame();
+        void     RenderQueuedFrame();
+        void     SaveCapture();
+        void     DrawGpuTimings();
+
+        bool m_GpuTimingsOverlay = false;
+
+        std::string m_CapturePath;
+
+        void RegisterTexture(Texture2D *texture, uint64_t hash, uint32_t width, uint32_t height);
+        void RecordSubmission(const Graphics::Backends::SubmitInfo &info);
+        void SaveRecording();
+
+        // What a capture needs to reference textures and blend states by hash
+        std::map<const void *, std::pair<uint64_t, CommandCapture::Texture>>            m_TextureRecords;
+        std::map<Graphics::Backends::BlendHandle, Graphics::Backends::TextureBlendInfo> m_BlendInfos;
+        uint64_t                                                                        m_TextureLoads = 0;
+
+        std::string           m_RecordPath;
+        uint32_t              m_RecordFrames = 0;
+        uint64_t              m_RecordFirstFrame = 0;
+        CommandCapture        m_Recording;
+        CommandCapture::Frame m_RecordingFrame;
+
+        uint64_t m_FrameIndex = 0;
+
+        IdleMode m_IdleMode = IdleMode::Always;
+        uint64_t m_LastFrameHash = 0;
+        uint64_t m_Generation = 0;
+
+        // Bumped from one counter whenever a submission goes to the target, so values never repeat
+        std::map<Graphics::Backends::RenderTargetHandle, uint64_t> m_TargetGenerations;
+        uint64_t                                                   m_TargetWrites = 0;
+        std::atomic<uint64_t> m_SkippedFrames{ 0 };
+
+        FrameList                 m_Frame;
+        std::unique_ptr<Pipeline> m_Pipeline;
     };
 } // namespace Graphics
 
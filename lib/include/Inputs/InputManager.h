@@ -5,10 +5,18 @@
 #include "Keys.h"
 #include <Math/Vector2.h>
 #include <SDL2/SDL.h>
+#include <Threads/SPSCQueue.h>
+#include <array>
+#include <atomic>
 #include <functional>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace Inputs {
+    const size_t kKeyCount = SDL_NUM_SCANCODES;
+    const size_t kMouseCount = 8;
+
     class Manager
     {
       public:
@@ -18,9 +26,34 @@ namespace Inputs {
         bool    IsMouseDown(Mouse button);
         Vector2 GetMousePosition();
 
+        /*
+            Edges between the last two NewFrame calls, made once per update by the thread asking
+            A tap shorter than a frame still reports both its press and its release.
+        */
+        void NewFrame();
+        bool IsKeyPressed(Keys key);
+        bool IsKeyReleased(Keys key);
+        bool IsMousePressed(Mouse button);
+        bool IsMouseReleased(Mouse button);
+
+        /*
+            Input events in arrival order, from the thread calling Update to a single consumer thread
+            Drain them once per update to judge input against the clock instead of the frame it landed in.
+            Nothing is queued until the consumer enables the queue, events are dropped while it is full.
+        */
+        void     EnableEventQueue(bool enabled);
+        bool     PollEvent(State &event);
+        void     DrainEvents(std::vector<State> &events);
+        uint64_t GetDroppedEvents();
+
         void ListenOnKeyEvent(std::function<void()> callback);
         void ListenOnMouseEvent(std::function<void()> callback);
 
+        // Presses and releases of one key or button, called on the thread running Update
+        uint32_t AddKeyListener(Keys key, std::function<void(const State &)> callback);
+        uint32_t AddMouseListener(Mouse button, std::function<void(const State &)> callback);
+        void     RemoveListener(uint32_t id);
+
         static Manager *Get();
         static void     Destroy();
 
@@ -33,13 +66,57 @@ namespace Inputs {
         void HandleKeyEvent(SDL_Event &event);
         void HandleMouseEvent(SDL_Event &event);
         void HandleMouseMotionEvent(SDL_Event &event);
+        void QueueEvent(State &event);
+
+        // Down while presses and releases differ, only the thread running Update writes them
+        struct Counter
+        {
+            std::atomic<uint32_t> Presses{ 0 };
+            std::atomic<uint32_t> Releases{ 0 };
+        };
+
+        struct Snapshot
+        {
+            uint32_t Presses = 0;
+            uint32_t Releases = 0;
+        };
 
-        std::map<Keys, bool>  KeyStates;
-        std::map<Mouse, bool> MouseStates;
+        std::array<Counter, kKeyCount>   KeyCounters;
+        std::array<Counter, kMouseCount> MouseCounters;
+
+        // Counters as of the last two NewFrame calls
+        std::array<Snapshot, kKeyCount>   KeyFrame;
+        std::array<Snapshot, kKeyCount>   KeyLastFrame;
+        std::array<Snapshot, kMouseCount> MouseFrame;
+        std::array<Snapshot, kMouseCount> MouseLastFrame;
+
+        struct Listener
+        {
+            uint32_t                           Id;
+            std::function<void(const State &)> Callback;
+        };
+
+        // Copied and replaced on change, dispatch holds on to the table it started with and never allocates
+        struct ListenerTable
+        {
+            std::array<std::vector<Listener>, kKeyCount>   KeyListeners;
+            std::array<std::vector<Listener>, kMouseCount> MouseListeners;
+        };
+
+        std::shared_ptr<const ListenerTable> Listeners;
+        std::mutex                           ListenerMutex;
+        uint32_t                             ListenerId = 0;
+
+        void Dispatch(const std::vector<Listener> &listeners, const State &event);
 
         std::function<void()> OnKeyEvent;
         std::function<void()> OnMouseEvent;
 
+        // About 4 seconds of mouse motion at 250 Hz, or far more key presses than anyone makes per frame
+        SPSCQueue<State, 1024> Events;
+        std::atomic<uint64_t>  DroppedEvents{ 0 };
+        std::atomic<bool>      EventQueueEnabled{ false };
+
         static Manager *Instance;
     };
 } // namespace Inputs
@@ -3,6 +3,7 @@
 
 #include <SDL2/SDL_mouse.h>
 #include <SDL2/SDL_scancode.h>
+#include <chrono>
 
 namespace Inputs {
     enum class Keys {
@@ -129,10 +130,12 @@ namespace Inputs {
         KeyUp,
         MouseDown,
         MouseUp,
+        MouseMove,
     };
 
     struct MouseState
     {
+        Mouse  Button;
         double X;
         double Y;
 
@@ -149,6 +152,9 @@ namespace Inputs {
     {
         Type Type;
 
+        // Taken on the window thread right after SDL_PollEvent returned the event
+        std::chrono::steady_clock::time_point Timestamp;
+
         union {
             MouseState    Mouse;
             KeyboardState Keyboard;
@@ -0,0 +1,15 @@
+#ifndef __PNG_H_
+#define __PNG_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace Misc {
+    namespace Png {
+        // RGBA8, top row first. Stored uncompressed, meant for captures and tests rather than assets
+        void Write(std::filesystem::path path, const std::vector<uint8_t> &pixels, int width, int height);
+    }
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef __JOBSYSTEM_H_
+#define __JOBSYSTEM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    Work-stealing job scheduler
+    Each worker pops its own deque from the back and steals from the front of the others, jobs submitted from
+    outside the workers go through a shared queue. A job runs once all of its dependencies finished.
+    Without Start() every job runs inline on the thread that made it runnable, continuations after the job that released them.
+*/
+class JobSystem
+{
+public:
+    struct Job
+    {
+        std::function<void()> function;
+
+        // Unfinished dependencies, plus one held by Submit until it registered them all
+        std::atomic<uint32_t> pending{ 1 };
+        std::atomic<bool>     done{ false };
+
+        // Thrown by function, rethrown by Wait
+        std::exception_ptr error;
+
+        std::mutex                        mutex;
+        std::vector<std::shared_ptr<Job>> continuations;
+    };
+
+    typedef std::shared_ptr<Job> JobHandle;
+
+    // 0 leaves a core each to the render, input and audio threads, at least one worker
+    void     Start(uint32_t threads = 0);
+    void     Stop();
+    uint32_t GetThreads();
+
+    JobHandle Submit(std::function<void()> function, const std::vector<JobHandle> &dependencies = {});
+    JobHandle Then(JobHandle job, std::function<void()> function);
+
+    // Runs other jobs while waiting, rethrows what the job threw
+    void Wait(JobHandle job);
+    void Wait(const std::vector<JobHandle> &jobs);
+    bool IsDone(JobHandle job);
+
+    // Calls function on [begin, end) chunks of at least grain items, the calling thread takes chunks too
+    void ParallelFor(size_t count, size_t grain, std::function<void(size_t begin, size_t end)> function);
+
+    static JobSystem *Get();
+    static void       Destroy();
+
+private:
+    JobSystem();
+    ~JobSystem();
+
+    static JobSystem *s_Instance;
+
+    struct Queue
+    {
+        std::mutex            mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    void      Release(JobHandle job);
+    void      Schedule(JobHandle job);
+    void      Execute(JobHandle job);
+    JobHandle Find(int worker);
+    void      WorkerLoop(int worker);
+
+    std::vector<std::thread>            m_Workers;
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    Queue                               m_Shared;
+
+    // Jobs sitting in any queue, workers sleep while it is 0
+    std::atomic<size_t>     m_Queued{ 0 };
+    std::atomic<uint32_t>   m_Sleeping{ 0 };
+    std::mutex              m_SleepMutex;
+    std::condition_variable m_SleepCondition;
+
+    // Threads in Wait with nothing left to run, notified when a job finishes
+    std::atomic<uint32_t>   m_Waiters{ 0 };
+    std::mutex              m_WaitMutex;
+    std::condition_variable m_WaitCondition;
+
+    std::atomic<bool> m_Running{ false };
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef __SPSCQUEUE_H_
+#define __SPSCQUEUE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/*
+    Fixed-size lock-free ring for exactly one producer thread and one consumer thread
+    Each side caches the other's index and only reloads it when the ring looks full or empty,
+    so the shared cache lines are touched once per wrap instead of once per item.
+*/
+template <typename T, size_t Capacity>
+class SPSCQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SPSCQueue capacity must be a power of two");
+
+public:
+    // Producer only, false when the ring is full
+    bool Push(const T &item)
+    {
+        size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head - m_TailCache == Capacity) {
+            m_TailCache = m_Tail.load(std::memory_order_acquire);
+            if (head - m_TailCache == Capacity) {
+                return false;
+            }
+        }
+
+        m_Items[head & (Capacity - 1)] = item;
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only, false when the ring is empty
+    bool Pop(T &item)
+    {
+        size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail == m_HeadCache) {
+            m_HeadCache = m_Head.load(std::memory_order_acquire);
+            if (tail == m_HeadCache) {
+                return false;
+            }
+        }
+
+        item = m_Items[tail & (Capacity - 1)];
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Producer side
+    alignas(64) std::atomic<size_t> m_Head{ 0 };
+    size_t m_TailCache = 0;
+
+    // Consumer side
+    alignas(64) std::atomic<size_t> m_Tail{ 0 };
+    size_t m_HeadCache = 0;
+
+    alignas(64) std::array<T, Capacity> m_Items;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <functional>
 #include <vector>
 #include <thread>
+#include "ThreadOptions.h"
 #include "TimeWatch.h"
 
 class Thread
@@ -23,9 +24,18 @@ public:
 
     void SetTickRate(double tickRate);
 
+    // See TimeWatch::SetSkipMissed
+    void SetSkipMissed(bool skip);
+
+    // Applied by the thread that starts or first ticks it
+    void SetOptions(ThreadOptions options);
+
     void Tick();
     std::thread::id GetId();
 
+    // See TimeWatch::GetJitter, call from this thread
+    TimeWatch::Jitter GetJitter();
+
     void AddCallback(std::function<void(void)>);
 
 private:
@@ -39,6 +49,7 @@ private:
     std::thread m_Thread;
     std::thread::id m_Id;
     TimeWatch m_TimeWatch;
+    ThreadOptions m_Options;
 };
 
 #endif
\ No newline at end of file
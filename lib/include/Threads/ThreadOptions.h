@@ -0,0 +1,32 @@
+#ifndef __THREADOPTIONS_H_
+#define __THREADOPTIONS_H_
+
+#include <cstdint>
+#include <string>
+
+/*
+    Scheduling of one thread, the defaults leave the OS in charge
+    Pin latency-critical threads to cores kept free of everything else (isolcpus= or a cpuset on Linux)
+    rather than only raising their priority, TimeWatch yields near deadlines and a realtime thread doing that
+    starves whatever shares its core.
+*/
+struct ThreadOptions
+{
+    // Shown by perf, top and debuggers, Linux keeps the first 15 characters
+    std::string name;
+
+    // Bit n allows CPU n, 0 allows all
+    uint64_t affinity = 0;
+
+    // SCHED_FIFO priority from 1 to 99 on Linux, time critical on Windows, 0 keeps the normal scheduler
+    // Needs CAP_SYS_NICE or an rtprio limit on Linux
+    int realtimePriority = 0;
+
+    // -20 to 19, lower runs first, used without realtimePriority, below 0 needs the same rights on Linux
+    int nice = 0;
+};
+
+// Applies options to the calling thread, false when any of them was refused, the rest still apply
+bool ApplyThreadOptions(const ThreadOptions &options);
+
+#endif
@@ -1,19 +1,58 @@
 #ifndef __TIMEWATCH_H_
 #define __TIMEWATCH_H_
 
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/*
+    Ticks on absolute deadlines of a monotonic clock, so the error of one tick doesn't carry into the next
+    Sleeps until shortly before the deadline and yields the rest, the OS wakes threads up too late for sub-ms rates.
+    How long it yields follows the measured sleep overshoot and stays a small share of the interval.
+*/
 class TimeWatch
 {
 public:
+    // How far ticks landed from their deadlines, in milliseconds, over the last kJitterSamples ticks
+    struct Jitter
+    {
+        uint64_t ticks = 0;
+        uint64_t skipped = 0;
+        double   mean = 0.0;
+        double   p99 = 0.0;
+        double   max = 0.0;
+    };
+
     TimeWatch();
     ~TimeWatch();
 
+    // Waits for the next deadline, returns the seconds since the previous tick
     double Tick();
-    void SetTickRate(double tickRate);
+    void   SetTickRate(double tickRate);
+
+    // A tick overrunning its slot drops the deadlines it missed, the next lands on the same grid, see Jitter::skipped
+    void SetSkipMissed(bool skip);
+
+    // Not synchronized, call from the thread that ticks
+    Jitter GetJitter();
 
 private:
-    double m_LastTick;
-    double m_CurTick;
-    double m_TickRate;
+    using Clock = std::chrono::steady_clock;
+
+    static const size_t kJitterSamples = 1024;
+
+    void WaitUntil(Clock::time_point deadline);
+
+    Clock::time_point m_LastTick;
+    Clock::time_point m_Deadline;
+    Clock::duration   m_Interval = Clock::duration::zero();
+    Clock::duration   m_SpinWindow = std::chrono::milliseconds(1);
+
+    std::vector<float> m_Samples;
+    size_t             m_SampleIndex = 0;
+    uint64_t           m_Ticks = 0;
+    uint64_t           m_Skipped = 0;
+    bool               m_SkipMissed = false;
 };
 
-#endif
\ No newline at end of file
+#endif
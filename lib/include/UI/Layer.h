@@ -0,0 +1,37 @@
+#ifndef __LAYER_H_
+#define __LAYER_H_
+
+#include "Image.h"
+#include <vector>
+
+namespace UI {
+    /*
+        Retained container
+        Children are rendered once into an offscreen target, after that the layer is a single quad.
+        Call MarkDirty() on the layer or on any child after changing it to render them again.
+        The target holds premultiplied colors, the layer is drawn with DefaultBlend::PREMULTIPLIED.
+    */
+    class Layer : public Image
+    {
+    public:
+        Layer();
+        ~Layer() override;
+
+        void Add(Base *child);
+        void Remove(Base *child);
+
+        void MarkDirty() override;
+
+    protected:
+        void OnDraw() override;
+
+    private:
+        std::vector<Base *> m_children;
+
+        Graphics::Backends::RenderTargetHandle m_target;
+        Rect                                   m_targetRect;
+        bool                                   m_dirty;
+    };
+} // namespace UI
+
+#endif
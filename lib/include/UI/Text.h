@@ -28,10 +28,14 @@ namespace UI {
 
     protected:
         void          OnDraw() override;
+        glm::vec2     GetPivot() override;
         Fonts::Glyph *FindGlyph(uint32_t c);
 
         std::string       m_TextToDraw;
         Fonts::FontAtlas *m_FontAtlas;
+
+        // Glyph bounds of the last OnDraw, min in xy and max in zw
+        glm::vec4 m_TextBounds;
     };
 } // namespace UI
 
@@ -42,12 +42,25 @@ namespace UI {
         virtual void Draw();
         virtual void Draw(Rect clipRect);
 
+        /*
+            Layout is memoized, an element is only recomputed when its own inputs or its parent's
+            rect changed. Each element is resolved once per frame, a parent moved after that is still
+            picked up by the children drawn after the move.
+            InvalidateLayout() forces the next CalculateSize() to recompute.
+        */
         void CalculateSize();
+        void InvalidateLayout();
+
+        // Tells a retaining ancestor (UI::Layer) that this element changed
+        virtual void MarkDirty();
 
     protected:
         virtual void OnDraw();
         void         InsertToBatch();
-        void         RotateVertex();
+
+        // Rotation is applied on the GPU around this point
+        virtual glm::vec2 GetPivot();
+        void              ApplyTransform(Graphics::Backends::SubmitInfo &info);
 
         glm::vec4 roundedCornerPixels;
 
@@ -64,7 +77,23 @@ namespace UI {
         std::vector<Graphics::Backends::SubmitInfo> m_batches;
 
     private:
-        void DrawVertices();
+        void  DrawVertices();
+        Base *GetLayoutParent();
+        void  ResolveLayout(uint64_t frame);
+
+        static constexpr int kLayoutInputs = 16;
+
+        bool   m_layoutValid = false;
+        Base  *m_layoutParent = nullptr;
+        double m_layoutInputs[kLayoutInputs] = {};
+
+        // Stamped when resolved in a frame, bumped whenever the rect is recomputed
+        uint64_t m_layoutFrame = UINT64_MAX;
+        uint64_t m_layoutGeneration = 0;
+        uint64_t m_layoutParentGeneration = 0;
+
+        // Next element down the chain CalculateSize resolves
+        Base *m_layoutNext = nullptr;
     };
 } // namespace UI
 
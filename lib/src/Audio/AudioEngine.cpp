@@ -116,4 +116,14 @@ void Engine::Destroy(Stream* stream)
 ma_context *Audio::Engine::GetContext()
 {
     return &m_Context;
-}
\ No newline at end of file
+}
+
+void Engine::SetThreadOptions(ThreadOptions options)
+{
+    m_ThreadOptions = options;
+}
+
+const ThreadOptions& Engine::GetThreadOptions()
+{
+    return m_ThreadOptions;
+}
@@ -75,6 +75,13 @@ void data_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uin
 {
     // using namespace soundtouch;
 
+    // miniaudio creates the device threads, each one configures itself once
+    thread_local bool configured = false;
+    if (!configured) {
+        configured = true;
+        ApplyThreadOptions(Audio::Engine::Get()->GetThreadOptions());
+    }
+
     ma_engine *pEngine = (ma_engine *)pDevice->pUserData;
     if (!pEngine) {
         return;
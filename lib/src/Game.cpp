@@ -7,10 +7,20 @@
 #include <Inputs/InputManager.h>
 #include <MsgBox.h>
 #include <Screens/ScreenManager.h>
+#include <Threads/JobSystem.h>
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iomanip>
 #include <iostream>
 
+// Timer cap over the refresh rate while a vsync'd present paces frames
+static const double kVsyncCapHeadroom = 1.05;
+
 Game::Game()
 {
 }
@@ -21,18 +31,50 @@ Game::~Game()
 
 void Game::Run(RunInfo info)
 {
-    int result = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
+    m_StartTime = std::chrono::steady_clock::now();
+    m_StartupPhases.clear();
+
+    // SDL's offscreen driver needs no display, GL then runs on an EGL pbuffer
+    if (info.swapchain.headless) {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+    }
+
+    int result = 0;
+    TimePhase("sdl", [&]() {
+        result = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS);
+    });
+
     if (result != 0) {
         std::cout << "Failed to initialize SDL: " << SDL_GetError() << std::endl;
         return;
     }
 
+    TimePhase("jobs", [&]() {
+        JobSystem::Get()->Start(info.jobThreads);
+    });
+
+    m_FixedStep = info.fixedUpdateRate > 0.0 ? 1.0 / info.fixedUpdateRate : 0.0;
+    m_Accumulator = 0.0;
+    m_MaxUpdateSteps = std::max(info.maxUpdateSteps, 1u);
+
+    m_FrameRate = info.frameRate;
+    m_PresentPaced = info.swapchain.presentMode == Graphics::Backends::PresentMode::Fifo && info.graphics != Graphics::API::Software && !info.swapchain.headless;
+
+    // Connecting to the sound server blocks on IPC and needs nothing from the window or renderer
+    auto engine = Audio::Engine::Get();
+    engine->SetThreadOptions(info.audioThread);
+
+    auto audio = JobSystem::Get()->Submit([=]() {
+        TimePhase("audio", [=]() {
+            engine->Init();
+        });
+    });
+
     try {
         auto window = Graphics::NativeWindow::Get();
-        window->Init(info.title, (int)info.resolution.X, (int)info.resolution.Y, info.graphics, info.fullscreen);
-
-        auto engine = Audio::Engine::Get();
-        engine->Init();
+        TimePhase("window", [&]() {
+            window->Init(info.title, (int)info.resolution.X, (int)info.resolution.Y, info.graphics, info.fullscreen, info.swapchain.headless);
+        });
 
         auto inputs = Inputs::Manager::Get();
         window->AddSDLCallback([=](SDL_Event &event) {
@@ -44,65 +86,188 @@ void Game::Run(RunInfo info)
         auto fontmanager = Fonts::FontManager::Get();
 
         if (info.threadMode == ThreadMode::Multi) {
-            auto oninit = [=]() {
-                scenemanager->Init(this);
-                renderer->Init(info.graphics, info.samplerInfo);
-                OnLoad();
+            // Set once OnLoad returned, errors of the draw thread's init reach the message box through it
+            std::promise<void> loaded;
+            std::atomic<bool>  ready{ false };
+
+            auto oninit = [=, &loaded, &ready]() {
+                try {
+                    TimePhase("screens", [=]() {
+                        scenemanager->Init(this);
+                    });
+
+                    TimePhase("renderer", [=]() {
+                        renderer->Init(info.graphics, info.samplerInfo, info.vertexFormat, info.swapchain);
+                        renderer->SetIdleMode(info.idleMode);
+                        renderer->SetRecordThreads(info.recordThreads);
+                    });
+
+                    // The audio context connected on the JobSystem meanwhile
+                    JobSystem::Get()->Wait(audio);
+
+                    TimePhase("load", [this]() {
+                        OnLoad();
+                    });
+
+                    if (info.pipelined) {
+                        renderer->SetPipelined(true);
+                    }
+
+                    ready = true;
+                    loaded.set_value();
+                } catch (...) {
+                    loaded.set_exception(std::current_exception());
+                    return;
+                }
+
+                if (info.logStartup) {
+                    PrintStartupPhases();
+                }
             };
 
-            auto onshutdown = [=]() {
-                OnUnload();
+            auto onshutdown = [=, &ready]() {
+                if (ready) {
+                    // Frames still queued are rendered before anything is unloaded
+                    if (info.pipelined) {
+                        renderer->SetPipelined(false);
+                    }
+
+                    OnUnload();
+                }
+
                 Screens::Manager::Destroy();
                 Fonts::FontManager::Destroy();
                 Graphics::Renderer::Destroy();
             };
 
-            auto onupdate = [=](double delta) {
-                OnUpdate(delta);
+            auto onupdate = [=, &ready](double delta) {
+                if (!ready) {
+                    return;
+                }
+
+                // Picks up the window moving to a display with another refresh rate
+                Thread &pacer = info.pipelined ? m_UpdateThread : m_DrawThread;
+                pacer.SetTickRate(GetDrawRate());
+
+                renderer->WaitForPresent();
+                double alpha = Update(delta);
 
                 bool shouldDraw = renderer->BeginFrame();
                 if (shouldDraw) {
-                    OnDraw(delta);
+                    OnDraw(delta, alpha);
                     renderer->EndFrame();
                 }
             };
 
-            m_DrawThread = Thread(oninit, onupdate, onshutdown, 240.0);
+            if (info.pipelined) {
+                // Unpaced, the update thread sets the frame rate
+                auto onrender = [=, &ready](double) {
+                    if (ready) {
+                        renderer->RenderPending(0.01);
+                    }
+                };
+
+                m_DrawThread = Thread(oninit, onrender, onshutdown, 0.0);
+                m_UpdateThread = Thread(onupdate, GetDrawRate());
+                m_UpdateThread.SetSkipMissed(true);
+            } else {
+                m_DrawThread = Thread(oninit, onupdate, onshutdown, GetDrawRate());
+                m_DrawThread.SetSkipMissed(true);
+            }
 
-            auto oninput = [=](double delta) {
-                window->PumpEvents();
+            // The cap sleeps instead of spinning, events arriving meanwhile are handled once it ends
+            auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(info.inputRate > 0.0 ? 1.0 / info.inputRate : 0.0));
+            auto nextInput = std::chrono::steady_clock::now();
+
+            auto oninput = [=, &nextInput](double delta) {
+                if (info.waitForEvents) {
+                    std::this_thread::sleep_until(nextInput);
+                    window->WaitEvents(info.inputIdleRate > 0.0 ? 1.0 / info.inputIdleRate : 1.0);
+                    nextInput = std::chrono::steady_clock::now() + interval;
+                } else {
+                    window->PumpEvents();
+                }
 
                 OnInput(delta);
             };
 
-            m_InputThread = Thread(oninput, 1000.0);
+            m_InputThread = Thread(oninput, info.waitForEvents ? 0.0 : info.inputRate);
+
+            m_DrawThread.SetOptions(info.drawThread);
+            m_UpdateThread.SetOptions(info.updateThread);
+            m_InputThread.SetOptions(info.inputThread);
 
+            // The renderer comes up while the audio context connects, OnLoad waits for both
+            auto load = loaded.get_future();
             m_DrawThread.Start();
 
-            while (!window->ShouldExit()) {
-                m_InputThread.Tick();
+            // Frames still queued are rendered by the draw thread before it shuts down
+            auto stop = [&]() {
+                if (info.pipelined) {
+                    m_UpdateThread.Stop();
+                }
+
+                m_DrawThread.Stop();
+            };
+
+            // The draw and update threads reference this frame's locals, they are stopped before any exit
+            try {
+                // The update thread starts once resources are loaded, otherwise events keep being pumped meanwhile
+                if (info.pipelined) {
+                    load.get();
+                    m_UpdateThread.Start();
+                }
+
+                while (!window->ShouldExit()) {
+                    if (load.valid() && load.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                        load.get();
+                    }
+
+                    m_InputThread.Tick();
+                }
+            } catch (...) {
+                stop();
+                throw;
             }
 
-            m_DrawThread.Stop();
+            stop();
         } else {
-            renderer->Init(info.graphics, info.samplerInfo);
-            scenemanager->Init(this);
-            OnLoad();
+            TimePhase("renderer", [=]() {
+                renderer->Init(info.graphics, info.samplerInfo, info.vertexFormat, info.swapchain);
+                renderer->SetIdleMode(info.idleMode);
+                renderer->SetRecordThreads(info.recordThreads);
+            });
+
+            TimePhase("screens", [=]() {
+                scenemanager->Init(this);
+            });
+
+            JobSystem::Get()->Wait(audio);
+
+            TimePhase("load", [this]() {
+                OnLoad();
+            });
+
+            if (info.logStartup) {
+                PrintStartupPhases();
+            }
 
             auto oninput = [=](double delta) {
+                renderer->WaitForPresent();
                 window->PumpEvents();
 
                 OnInput(delta);
-                OnUpdate(delta);
+                double alpha = Update(delta);
 
                 bool shouldDraw = renderer->BeginFrame();
                 if (shouldDraw) {
-                    OnDraw(delta);
+                    OnDraw(delta, alpha);
                     renderer->EndFrame();
                 }
             };
 
-            m_InputThread = Thread(oninput, 1000.0);
+            m_InputThread = Thread(oninput, info.inputRate);
+            m_InputThread.SetOptions(info.inputThread);
 
             while (!window->ShouldExit()) {
                 m_InputThread.Tick();
@@ -122,9 +287,120 @@ void Game::Run(RunInfo info)
         MsgBox::Show("Error", e.what(), MsgBox::Type::Ok, MsgBox::Flags::Error);
     }
 
+    // Still running when the window failed, its error was already reported or doesn't matter anymore
+    try {
+        JobSystem::Get()->Wait(audio);
+    } catch (Exceptions::EstException &) {
+    }
+
+    JobSystem::Destroy();
+
     SDL_Quit();
 }
 
+double Game::Update(double delta)
+{
+    auto inputs = Inputs::Manager::Get();
+
+    if (m_FixedStep <= 0.0) {
+        inputs->NewFrame();
+        OnUpdate(delta);
+        return 1.0;
+    }
+
+    m_Accumulator += delta;
+
+    // Edges are taken per update, a frame running none keeps them for the next one
+    uint32_t steps = 0;
+    while (m_Accumulator >= m_FixedStep && steps < m_MaxUpdateSteps) {
+        inputs->NewFrame();
+        OnUpdate(m_FixedStep);
+
+        m_Accumulator -= m_FixedStep;
+        steps++;
+    }
+
+    // Still behind after the last step, the game slows down instead of spiraling
+    if (m_Accumulator >= m_FixedStep) {
+        m_Accumulator = std::fmod(m_Accumulator, m_FixedStep);
+    }
+
+    return m_Accumulator / m_FixedStep;
+}
+
+double Game::GetDrawRate()
+{
+    double refresh = Graphics::NativeWindow::Get()->GetRefreshRate();
+    double target = m_FrameRate > 0.0 ? m_FrameRate : (refresh > 0.0 ? refresh : 60.0);
+
+    if (!m_PresentPaced || refresh <= 0.0) {
+        return target;
+    }
+
+    // The vsync'd present paces the loop, the cap only holds when nothing is presented, like with
+    // IdleMode::SkipUnchanged or a minimized window. Kept above the refresh rate since SDL rounds it to whole Hz
+    if (target >= refresh) {
+        return refresh * kVsyncCapHeadroom;
+    }
+
+    // Every n-th vblank, so each frame stays on screen for the same number of refreshes
+    return refresh / std::ceil(refresh / target);
+}
+
+void Game::TimePhase(const char *name, const std::function<void()> &function)
+{
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+
+    StartupPhase phase;
+    phase.name = name;
+    phase.thread = std::this_thread::get_id();
+    phase.begin = std::chrono::duration<double>(begin - m_StartTime).count();
+    phase.end = std::chrono::duration<double>(end - m_StartTime).count();
+
+    std::lock_guard<std::mutex> lock(m_StartupMutex);
+    m_StartupPhases.push_back(phase);
+}
+
+std::vector<StartupPhase> Game::GetStartupPhases()
+{
+    std::lock_guard<std::mutex> lock(m_StartupMutex);
+    return m_StartupPhases;
+}
+
+void Game::PrintStartupPhases()
+{
+    auto phases = GetStartupPhases();
+    std::sort(phases.begin(), phases.end(), [](const StartupPhase &a, const StartupPhase &b) {
+        return a.begin < b.begin;
+    });
+
+    std::cout << "Startup, ms since Run:" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (auto &phase : phases) {
+        std::cout << "  " << std::left << std::setw(10) << phase.name << std::right
+                  << std::setw(9) << phase.begin * 1000.0 << " -> " << std::setw(9) << phase.end * 1000.0
+                  << "  (" << (phase.end - phase.begin) * 1000.0 << ")  thread " << phase.thread << std::endl;
+    }
+
+    std::cout << std::defaultfloat;
+}
+
+TimeWatch::Jitter Game::GetTickJitter()
+{
+    if (std::this_thread::get_id() == m_DrawThread.GetId()) {
+        return m_DrawThread.GetJitter();
+    }
+
+    if (std::this_thread::get_id() == m_UpdateThread.GetId()) {
+        return m_UpdateThread.GetJitter();
+    }
+
+    return m_InputThread.GetJitter();
+}
+
 void Game::OnLoad()
 {
     rect = std::make_unique<UI::Text>();
@@ -151,4 +427,9 @@ void Game::OnDraw(double delta)
 {
     auto scenemanager = Screens::Manager::Get();
     scenemanager->Draw(delta);
+}
+
+void Game::OnDraw(double delta, double)
+{
+    OnDraw(delta);
 }
\ No newline at end of file
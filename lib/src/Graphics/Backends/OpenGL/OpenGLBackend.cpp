@@ -31,14 +31,27 @@ struct PushConstant
 
     glm::vec2 scale;
     glm::vec2 translate;
+
+    glm::vec2 pivot;
+    glm::vec4 transform;
+    glm::vec2 offset;
+
+    float depth;
 };
 
 uint32_t glBlendOperatioId;
 
-std::string compileSPRIV(const uint32_t *data, size_t size)
+std::string compileSPRIV(const uint32_t *data, size_t size, ShaderVariant variant = ShaderVariant::Rounded)
 {
     spirv_cross::CompilerGLSL compiler(data, size);
 
+    // GLSL has no specialization, bake the variant in as the constant's value
+    for (auto &constant : compiler.get_specialization_constants()) {
+        if (constant.constant_id == 0) {
+            compiler.get_constant(constant.id).m.c[0].r[0].i32 = (int32_t)variant;
+        }
+    }
+
     spirv_cross::CompilerGLSL::Options options;
     options.version = 430;
     options.emit_push_constant_as_uniform_buffer = true;
@@ -47,6 +60,16 @@ std::string compileSPRIV(const uint32_t *data, size_t size)
     return compiler.compile();
 }
 
+void OpenGL::SetVertexFormat(VertexFormat format)
+{
+    vertexFormat = format;
+}
+
+void OpenGL::SetSwapchainInfo(SwapchainInfo info)
+{
+    swapchainInfo = info;
+}
+
 void OpenGL::Init()
 {
     auto window = Graphics::NativeWindow::Get();
@@ -85,6 +108,30 @@ void OpenGL::Init()
 
     Data.ctx = context;
 
+    // GL has no mailbox, adaptive vsync is the closest: no tearing unless a frame is late
+    int interval = 1;
+    switch (swapchainInfo.presentMode) {
+        case PresentMode::Immediate:
+            interval = 0;
+            break;
+
+        case PresentMode::Mailbox:
+            interval = -1;
+            break;
+
+        default:
+            break;
+    }
+
+    // A headless surface has no display to sync to
+    if (swapchainInfo.headless) {
+        interval = 0;
+    }
+
+    if (SDL_GL_SetSwapInterval(interval) != 0 && interval == -1) {
+        SDL_GL_SetSwapInterval(1);
+    }
+
     constexpr uint32_t MAX_VERTEX_OBJECTS = 50000;
     constexpr uint32_t MAX_VERTEX_BUFFER_SIZE = sizeof(Vertex) * MAX_VERTEX_OBJECTS;
     constexpr uint32_t MAX_INDEX_BUFFER_SIZE = sizeof(uint32_t) * MAX_VERTEX_OBJECTS;
@@ -113,6 +160,15 @@ void OpenGL::Init()
     CreateShader();
     CreateDefaultBlend();
 
+    // Drivers queue up to three frames, the fourth set is the oldest one and likely done
+    if (GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query) {
+        timers.resize(4);
+        for (auto &frame : timers) {
+            glGenQueries((GLsizei)GLTimerPass::Count, frame.queries);
+            frame.pending = false;
+        }
+    }
+
     ImGui_Init();
 }
 
@@ -123,7 +179,13 @@ void OpenGL::CreateShader()
         { ShaderFragmentType::Image, { __glsl_image, sizeof(__glsl_image) / sizeof(__glsl_image[0]) } }
     };
 
+    std::vector<std::pair<ShaderKey, std::pair<const uint32_t *, size_t>>> variants;
     for (auto &[type, shader] : shaders) {
+        variants.push_back({ { type, ShaderVariant::Square }, shader });
+        variants.push_back({ { type, ShaderVariant::Rounded }, shader });
+    }
+
+    for (auto &[key, shader] : variants) {
         auto          vertex = compileSPRIV(__glsl_position, sizeof(__glsl_position) / sizeof(__glsl_position[0]));
         const GLchar *sourcevertex = (const GLchar *)vertex.c_str();
 
@@ -140,7 +202,7 @@ void OpenGL::CreateShader()
             throw Exceptions::EstException("Failed to compile vertex shader");
         }
 
-        auto          fragment = compileSPRIV(shader.first, shader.second);
+        auto          fragment = compileSPRIV(shader.first, shader.second, key.second);
         const GLchar *sourcefragment = (const GLchar *)fragment.c_str();
 
         std::cout << fragment << std::endl;
@@ -172,7 +234,7 @@ void OpenGL::CreateShader()
             throw Exceptions::EstException("Failed to link shader program");
         }
 
-        Data.shaders[type] = { shaderId, fragmentId, programId };
+        Data.shaders[key] = { shaderId, fragmentId, programId };
     }
 }
 
@@ -183,6 +245,7 @@ void OpenGL::CreateDefaultBlend()
     // ADD, dstRGB = (srcRGB * srcA) + dstRGB, dstA = dstA
     // MOD, dstRGB = srcRGB * dstRGB, dstA = dstA
     // MUL dstRGB = (srcRGB * dstRGB) + (dstRGB * (1-srcA)), dstA = (srcA * dstA) + (dstA * (1-srcA))
+    // PREMULTIPLIED, dstRGB = srcRGB + (dstRGB * (1-srcA)), dstA = srcA + (dstA * (1-srcA))
 
     TextureBlendInfo blendNone = {
         true,
@@ -199,7 +262,7 @@ void OpenGL::CreateDefaultBlend()
         BlendFactor::BLEND_FACTOR_SRC_ALPHA,
         BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         BlendOp::BLEND_OP_ADD,
-        BlendFactor::BLEND_FACTOR_SRC_ALPHA,
+        BlendFactor::BLEND_FACTOR_ONE,
         BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         BlendOp::BLEND_OP_ADD
     };
@@ -234,15 +297,30 @@ void OpenGL::CreateDefaultBlend()
         BlendOp::BLEND_OP_ADD
     };
 
+    TextureBlendInfo blendPremultiplied = {
+        true,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD
+    };
+
     CreateBlendState(blendNone);
     CreateBlendState(blendBlend);
     CreateBlendState(blendAdd);
     CreateBlendState(blendMod);
     CreateBlendState(blendMul);
+    CreateBlendState(blendPremultiplied);
 }
 
 void OpenGL::Shutdown()
 {
+    while (renderTargets.size()) {
+        DestroyRenderTarget(renderTargets.begin()->first);
+    }
+
     for (GLuint texture : textures) {
         glDeleteTextures(1, &texture);
     }
@@ -251,6 +329,12 @@ void OpenGL::Shutdown()
 
     textures.clear();
 
+    for (auto &frame : timers) {
+        glDeleteQueries((GLsizei)GLTimerPass::Count, frame.queries);
+    }
+
+    timers.clear();
+
     // free the buffer
     glDeleteBuffers(1, &Data.vertexBuffer);
     glDeleteBuffers(1, &Data.indexBuffer);
@@ -288,22 +372,129 @@ bool OpenGL::BeginFrame()
     glScissor(0, 0, rect.Width, rect.Height);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClearDepthf(1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glDepthMask(GL_TRUE);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     return true;
 }
 
 void OpenGL::EndFrame()
 {
+    // A set still in flight is skipped rather than waited on, this frame just goes unmeasured
+    timing = false;
+    if (timers.size()) {
+        auto &frame = timers[timerIndex];
+        ReadTimers(frame);
+
+        timing = !frame.pending;
+    }
+
     FlushQueue();
 
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    BeginTimer(GLTimerPass::ImGui);
+    ImGui_ImplOpenGL3_RenderDrawData(imguiDrawData ? imguiDrawData : ImGui::GetDrawData());
+    EndTimer();
+
+    if (timing) {
+        timers[timerIndex].pending = true;
+        timerIndex = (timerIndex + 1) % timers.size();
+    }
+
+    // Read before the swap, the back buffer is undefined afterwards
+    if (captureRequested) {
+        captureRequested = false;
+        captureRect = Graphics::NativeWindow::Get()->GetWindowSize();
+
+        size_t stride = (size_t)captureRect.Width * 4;
+        capture.resize(stride * captureRect.Height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, captureRect.Width, captureRect.Height, GL_RGBA, GL_UNSIGNED_BYTE, capture.data());
+
+        // GL rows start at the bottom
+        std::vector<uint8_t> row(stride);
+        for (int y = 0; y < captureRect.Height / 2; y++) {
+            uint8_t *top = capture.data() + y * stride;
+            uint8_t *bottom = capture.data() + (captureRect.Height - 1 - y) * stride;
+
+            memcpy(row.data(), top, stride);
+            memcpy(top, bottom, stride);
+            memcpy(bottom, row.data(), stride);
+        }
+    }
 
     SDL_GL_SwapWindow((SDL_Window *)Graphics::NativeWindow::Get()->GetWindow());
+
+    // The driver queues frames on its own, a single frame in flight means waiting for this one here
+    if (swapchainInfo.framesInFlight <= 1 && !swapchainInfo.waitForPresent) {
+        glFinish();
+    }
+}
+
+void OpenGL::WaitForPresent()
+{
+    glFinish();
+}
+
+void OpenGL::BeginTimer(GLTimerPass pass)
+{
+    if (timing) {
+        glBeginQuery(GL_TIME_ELAPSED, timers[timerIndex].queries[(size_t)pass]);
+    }
+}
+
+void OpenGL::EndTimer()
+{
+    if (timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+}
+
+void OpenGL::ReadTimers(GLTimerQueries &frame)
+{
+    if (!frame.pending) {
+        return;
+    }
+
+    // Queries complete in order, the last one being available means all of them are
+    GLuint available = 0;
+    glGetQueryObjectuiv(frame.queries[(size_t)GLTimerPass::ImGui], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return;
+    }
+
+    GLuint64 elapsed[(size_t)GLTimerPass::Count];
+    for (size_t i = 0; i < (size_t)GLTimerPass::Count; i++) {
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &elapsed[i]);
+    }
+
+    frame.pending = false;
+
+    gpuTimings.valid = true;
+    gpuTimings.targets = elapsed[(size_t)GLTimerPass::Targets] / 1000000.0;
+    gpuTimings.main = elapsed[(size_t)GLTimerPass::Main] / 1000000.0;
+    gpuTimings.imgui = elapsed[(size_t)GLTimerPass::ImGui] / 1000000.0;
+    gpuTimings.total = gpuTimings.targets + gpuTimings.main + gpuTimings.imgui;
+}
+
+GpuTimings OpenGL::GetGpuTimings()
+{
+    return gpuTimings;
+}
+
+void OpenGL::SetImGuiDrawData(ImDrawData *data)
+{
+    imguiDrawData = data;
 }
 
 void OpenGL::Push(SubmitInfo &info)
 {
+    if (currentTarget != kBackbuffer) {
+        renderTargets[currentTarget].submitInfos.push_back(info);
+        return;
+    }
+
     submitInfos.push_back(info);
 }
 
@@ -391,14 +582,56 @@ void setBlendInfo(const TextureBlendInfo &blendInfo)
 
 void OpenGL::FlushQueue()
 {
-    if (submitInfos.size() == 0) {
+    BeginTimer(GLTimerPass::Targets);
+
+    // A layer nested in another layer is activated after its parent, so walk backwards
+    for (auto it = targetOrder.rbegin(); it != targetOrder.rend(); it++) {
+        auto target = renderTargets.find(*it);
+        if (target == renderTargets.end() || target->second.submitInfos.size() == 0) {
+            continue;
+        }
+
+        auto &info = target->second;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, info.framebuffer);
+        glViewport(0, 0, info.rect.Width, info.rect.Height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        DrawQueue(info.submitInfos, info.rect, true);
+    }
+
+    targetOrder.clear();
+
+    EndTimer();
+    BeginTimer(GLTimerPass::Main);
+
+    auto rect = Graphics::NativeWindow::Get()->GetWindowSize();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, rect.Width, rect.Height);
+
+    DrawQueue(submitInfos, { 0, 0, rect.Width, rect.Height }, false);
+
+    EndTimer();
+}
+
+void OpenGL::DrawQueue(std::vector<SubmitInfo> &queue, Rect rect, bool flip)
+{
+    if (queue.size() == 0) {
         return;
     }
 
+    std::stable_sort(queue.begin(), queue.end(), [](const SubmitInfo &a, const SubmitInfo &b) {
+        return a.zIndex < b.zIndex;
+    });
+
+    bool   compact = vertexFormat == VertexFormat::Compact;
+    GLuint vertex_stride = compact ? sizeof(CompactVertex) : sizeof(Vertex);
     GLuint vertex_size = 0;
     GLuint indices_size = 0;
-    for (auto &info : submitInfos) {
-        vertex_size += (GLuint)(info.vertices.size() * sizeof(info.vertices[0]));
+    for (auto &info : queue) {
+        vertex_size += (GLuint)(info.vertices.size() * vertex_stride);
         indices_size += (GLuint)(info.indices.size() * sizeof(info.indices[0]));
     }
 
@@ -411,16 +644,19 @@ void OpenGL::FlushQueue()
     glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_size, nullptr);
     glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices_size, nullptr);
 
-    std::vector<Vertex>   vertices;
-    std::vector<uint16_t> indices;
+    std::vector<Vertex>        vertices;
+    std::vector<CompactVertex> compactVertices;
+    std::vector<uint16_t>      indices;
 
     uint16_t currentVertexCount = 0;
 
-    auto rect = Graphics::NativeWindow::Get()->GetWindowSize();
-
-    for (auto &info : submitInfos) {
+    for (auto &info : queue) {
         for (auto &vertex : info.vertices) {
-            vertices.push_back(vertex);
+            if (compact) {
+                compactVertices.push_back(ToCompactVertex(vertex));
+            } else {
+                vertices.push_back(vertex);
+            }
         }
 
         for (uint16_t index : info.indices) {
@@ -430,39 +666,68 @@ void OpenGL::FlushQueue()
         currentVertexCount += (uint16_t)info.vertices.size();
     }
 
-    GLuint vertex_offset = 0;
     GLuint indices_offset = 0;
 
     glBindBuffer(GL_ARRAY_BUFFER, Data.vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STREAM_DRAW);
+    if (compact) {
+        glBufferData(GL_ARRAY_BUFFER, compactVertices.size() * sizeof(CompactVertex), compactVertices.data(), GL_STREAM_DRAW);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STREAM_DRAW);
+    }
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Data.indexBuffer);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STREAM_DRAW);
 
-    // Position attribute
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)MY_OFFSETOF(Vertex, pos));
-
-    // Texture coordinates attribute
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)MY_OFFSETOF(Vertex, texCoord));
-
-    // Color attribute
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *)MY_OFFSETOF(Vertex, color));
+
+    if (compact) {
+        glVertexAttribPointer(0, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void *)MY_OFFSETOF(CompactVertex, pos));
+        glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(CompactVertex), (void *)MY_OFFSETOF(CompactVertex, texCoord));
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(CompactVertex), (void *)MY_OFFSETOF(CompactVertex, color));
+    } else {
+        // Position attribute
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)MY_OFFSETOF(Vertex, pos));
+
+        // Texture coordinates attribute
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)MY_OFFSETOF(Vertex, texCoord));
+
+        // Color attribute
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *)MY_OFFSETOF(Vertex, color));
+    }
 
     PushConstant pc = {};
     pc.scale = glm::vec2(2.0f / rect.Width, -2.0f / rect.Height);
-    pc.translate = glm::vec2(-1.0f, 1.0f);
+    pc.translate = glm::vec2(-1.0f - rect.X * pc.scale.x, 1.0f - rect.Y * pc.scale.y);
+
+    // Render targets keep row 0 at the top so they sample like any uploaded texture
+    if (flip) {
+        pc.scale.y = -pc.scale.y;
+        pc.translate.y = -1.0f - rect.Y * pc.scale.y;
+    }
+
+    // Compact positions arrive in the shader scaled by kCompactPositionUnit
+    float unit = compact ? kCompactPositionUnit : 1.0f;
+    pc.scale /= unit;
+
+    std::vector<GLuint> firstIndices(queue.size());
+    for (size_t i = 0; i < queue.size(); i++) {
+        firstIndices[i] = indices_offset;
+        indices_offset += (GLuint)queue[i].indices.size();
+    }
 
-    for (auto &info : submitInfos) {
-        auto  &vertices = info.vertices;
-        auto  &indices = info.indices;
-        auto   shadertype = info.fragmentType;
+    auto draw = [&](size_t i, bool opaque) {
+        auto  &info = queue[i];
+        auto   shadertype = ShaderKey(info.fragmentType, GetShaderVariant(info));
         GLuint imageId = static_cast<GLuint>(reinterpret_cast<intptr_t>(info.image));
 
         pc.ui_radius = info.uiRadius;
         pc.ui_size = info.uiSize;
+        pc.pivot = info.pivot * unit;
+        pc.transform = info.transform;
+        pc.offset = info.offset * unit;
+        pc.depth = GetSubmissionDepth(i, queue.size());
 
         glBindBuffer(GL_UNIFORM_BUFFER, Data.constantBuffer);
         glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PushConstant), &pc);
@@ -477,25 +742,48 @@ void OpenGL::FlushQueue()
             glUniform1d(textureLocation, 0);
         }
 
-        auto &blend = blendStates[info.alphablend];
+        auto &blend = blendStates[opaque ? DefaultBlend::NONE : info.alphablend];
         setBlendInfo(blend);
 
-        GLuint firstIndex = indices_offset;
+        GLuint firstIndex = firstIndices[i];
         GLuint indexCount = (GLuint)info.indices.size();
 
         glScissor(
-            (GLint)info.clipRect.X,
-            (GLint)info.clipRect.Y,
+            (GLint)(info.clipRect.X - rect.X),
+            (GLint)(info.clipRect.Y - rect.Y),
             (GLsizei)info.clipRect.Width,
             (GLsizei)info.clipRect.Height);
 
         glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, (void *)(firstIndex * sizeof(uint16_t)));
+    };
+
+    std::vector<bool> opaque(queue.size());
+    for (size_t i = 0; i < queue.size(); i++) {
+        opaque[i] = IsOpaque(queue[i]);
+    }
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
 
-        vertex_offset += indexCount;
-        indices_offset += indexCount;
+    // Front-to-back so covered pixels fail the depth test before shading
+    glDepthMask(GL_TRUE);
+    for (size_t i = queue.size(); i-- > 0;) {
+        if (opaque[i]) {
+            draw(i, true);
+        }
     }
 
-    submitInfos.clear();
+    glDepthMask(GL_FALSE);
+    for (size_t i = 0; i < queue.size(); i++) {
+        if (!opaque[i]) {
+            draw(i, false);
+        }
+    }
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_DEPTH_TEST);
+
+    queue.clear();
 }
 
 GLuint OpenGL::CreateTexture()
@@ -517,10 +805,132 @@ void OpenGL::DestroyTexture(GLuint texture)
     glDeleteTextures(1, &texture);
 }
 
+RenderTargetHandle OpenGL::CreateRenderTarget(Rect rect)
+{
+    if (rect.Width <= 0 || rect.Height <= 0) {
+        throw Exceptions::EstException("Invalid render target size");
+    }
+
+    GLRenderTarget target = {};
+    target.rect = rect;
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, rect.Width, rect.Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenRenderbuffers(1, &target.depthbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depthbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, rect.Width, rect.Height);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depthbuffer);
+
+    auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status == GL_FRAMEBUFFER_COMPLETE) {
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        glDeleteFramebuffers(1, &target.framebuffer);
+        glDeleteRenderbuffers(1, &target.depthbuffer);
+        glDeleteTextures(1, &target.texture);
+
+        throw Exceptions::EstException("Failed to create render target framebuffer");
+    }
+
+    RenderTargetHandle handle = ++renderTargetId;
+    renderTargets[handle] = std::move(target);
+
+    return handle;
+}
+
+void OpenGL::DestroyRenderTarget(RenderTargetHandle handle)
+{
+    auto it = renderTargets.find(handle);
+    if (it == renderTargets.end()) {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &it->second.framebuffer);
+    glDeleteRenderbuffers(1, &it->second.depthbuffer);
+    glDeleteTextures(1, &it->second.texture);
+
+    renderTargets.erase(it);
+
+    targetOrder.erase(std::remove(targetOrder.begin(), targetOrder.end(), handle), targetOrder.end());
+    if (currentTarget == handle) {
+        currentTarget = kBackbuffer;
+    }
+}
+
+void OpenGL::SetRenderTarget(RenderTargetHandle handle)
+{
+    if (handle != kBackbuffer) {
+        if (renderTargets.find(handle) == renderTargets.end()) {
+            throw Exceptions::EstException("Invalid render target");
+        }
+
+        if (std::find(targetOrder.begin(), targetOrder.end(), handle) == targetOrder.end()) {
+            targetOrder.push_back(handle);
+        }
+    }
+
+    currentTarget = handle;
+}
+
+const void *OpenGL::GetRenderTargetImage(RenderTargetHandle handle)
+{
+    auto it = renderTargets.find(handle);
+    if (it == renderTargets.end()) {
+        return nullptr;
+    }
+
+    return (const void *)(uintptr_t)it->second.texture;
+}
+
+bool OpenGL::Represent(uint64_t)
+{
+    // The back buffer is undefined after SDL_GL_SwapWindow, always redraw
+    return false;
+}
+
 void OpenGL::SetClearColor(glm::vec4 color)
 {
 }
 
+void OpenGL::RequestCapture()
+{
+    captureRequested = true;
+}
+
+bool OpenGL::ReadCapture(std::vector<uint8_t> &pixels, int &width, int &height)
+{
+    if (capture.empty()) {
+        return false;
+    }
+
+    pixels = std::move(capture);
+    width = captureRect.Width;
+    height = captureRect.Height;
+
+    capture.clear();
+    return true;
+}
+
+void OpenGL::SetRecordThreads(uint32_t threads)
+{
+    // GL calls are bound to the context's thread, everything is recorded on it
+}
+
 void OpenGL::SetClearDepth(float depth)
 {
 }
@@ -546,6 +956,9 @@ void OpenGL::ImGui_Init()
     });
 
     ImGui_ImplOpenGL3_Init();
+
+    // Created up front, NewFrame would otherwise need the context on whichever thread builds the UI
+    ImGui_ImplOpenGL3_CreateDeviceObjects();
 }
 
 void OpenGL::ImGui_DeInit()
@@ -22,7 +22,31 @@ namespace Graphics {
             GLuint                                   constantBuffer;
             GLuint                                   maxVertexBufferSize;
             GLuint                                   maxIndexBufferSize;
-            std::map<ShaderFragmentType, ShaderData> shaders;
+            std::map<ShaderKey, ShaderData>          shaders;
+        };
+
+        struct GLRenderTarget
+        {
+            Rect                    rect;
+            GLuint                  framebuffer;
+            GLuint                  texture;
+            GLuint                  depthbuffer;
+            std::vector<SubmitInfo> submitInfos;
+        };
+
+        // GL_TIME_ELAPSED can't nest, each pass gets its own query
+        enum class GLTimerPass {
+            Targets = 0,
+            Main = 1,
+            ImGui = 2,
+            Count = 3,
+        };
+
+        // Queries of one frame, reused once their results were read
+        struct GLTimerQueries
+        {
+            GLuint queries[(size_t)GLTimerPass::Count];
+            bool   pending;
         };
 
         class OpenGL : public Base
@@ -30,6 +54,9 @@ namespace Graphics {
         public:
             virtual ~OpenGL() = default;
 
+            virtual void SetVertexFormat(VertexFormat format) override;
+            virtual void SetSwapchainInfo(SwapchainInfo info) override;
+
             virtual void Init() override;
             virtual void ReInit() override;
             virtual void Shutdown() override;
@@ -39,6 +66,8 @@ namespace Graphics {
             virtual bool BeginFrame() override;
             virtual void EndFrame() override;
 
+            virtual void WaitForPresent() override;
+
             virtual void ImGui_Init() override;
             virtual void ImGui_DeInit() override;
             virtual void ImGui_NewFrame() override;
@@ -52,6 +81,21 @@ namespace Graphics {
 
             virtual BlendHandle CreateBlendState(TextureBlendInfo blendInfo) override;
 
+            virtual RenderTargetHandle CreateRenderTarget(Rect rect) override;
+            virtual void               DestroyRenderTarget(RenderTargetHandle handle) override;
+            virtual void               SetRenderTarget(RenderTargetHandle handle) override;
+            virtual const void        *GetRenderTargetImage(RenderTargetHandle handle) override;
+
+            virtual bool Represent(uint64_t hash) override;
+
+            virtual void SetRecordThreads(uint32_t threads) override;
+
+            virtual void RequestCapture() override;
+            virtual bool ReadCapture(std::vector<uint8_t> &pixels, int &width, int &height) override;
+
+            virtual GpuTimings GetGpuTimings() override;
+            virtual void       SetImGuiDrawData(ImDrawData *data) override;
+
             GLuint CreateTexture();
             void   DestroyTexture(GLuint texture);
 
@@ -59,12 +103,36 @@ namespace Graphics {
             void CreateShader();
             void CreateDefaultBlend();
 
+            void       BeginTimer(GLTimerPass pass);
+            void       EndTimer();
+            void       ReadTimers(GLTimerQueries &frame);
             void       FlushQueue();
+            void       DrawQueue(std::vector<SubmitInfo> &queue, Rect rect, bool flip);
             OpenGLData Data;
 
+            VertexFormat  vertexFormat = VertexFormat::Float;
+            SwapchainInfo swapchainInfo;
+
             std::vector<SubmitInfo>                 submitInfos;
             std::vector<GLuint>                     textures;
             std::map<BlendHandle, TextureBlendInfo> blendStates;
+
+            std::map<RenderTargetHandle, GLRenderTarget> renderTargets;
+            std::vector<RenderTargetHandle>              targetOrder;
+            RenderTargetHandle                           currentTarget = kBackbuffer;
+            RenderTargetHandle                           renderTargetId = 0;
+
+            bool                 captureRequested = false;
+            std::vector<uint8_t> capture;
+            Rect                 captureRect = {};
+
+            // Ring of frames the driver may still be working on, empty without timer query support
+            std::vector<GLTimerQueries> timers;
+            size_t                      timerIndex = 0;
+            bool                        timing = false;
+            GpuTimings                  gpuTimings;
+
+            ImDrawData *imguiDrawData = nullptr;
         };
     } // namespace Backends
 } // namespace Graphics
@@ -22,6 +22,9 @@ GLTexture2D::GLTexture2D(TextureSamplerInfo samplerInfo)
 
 GLTexture2D::~GLTexture2D()
 {
+    if (Data.Id != kInvalidTexture) {
+        Graphics::Renderer::Get()->UnregisterTexture(GetId());
+    }
 }
 
 void GLTexture2D::Load(std::filesystem::path path)
@@ -66,6 +69,8 @@ void GLTexture2D::Load(const char *pixbuf, uint32_t width, uint32_t height)
         throw Exceptions::EstException("Texture already loaded");
     }
 
+    Opaque = IsOpaquePixels(pixbuf, width, height);
+
     glGenTextures(1, &Data.Id);
     glBindTexture(GL_TEXTURE_2D, Data.Id);
 
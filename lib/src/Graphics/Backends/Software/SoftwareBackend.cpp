@@ -0,0 +1,1213 @@
+#include "SoftwareBackend.h"
+#include <Exceptions/EstException.h>
+#include <Graphics/NativeWindow.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+#include "../../ImguiBackends/imgui_impl_sdl2.h"
+
+using namespace Graphics;
+using namespace Graphics::Backends;
+
+namespace {
+    // Tiles are rasterized independently, each by one thread
+    const int kTileSize = 64;
+
+    // Vertex positions snap to 1/16 px like the GPU's subpixel grid, edge tests are exact integers
+    const int     kSubpixelBits = 4;
+    const int64_t kSubpixels = 1 << kSubpixelBits;
+    const float   kMaxFixed = (float)(1 << 24);
+
+    // Same as image.frag and solid.frag
+    const float kSmoothness = 0.7f;
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    inline glm::vec4 UnpackColor(uint32_t color)
+    {
+        const float inv = 1.0f / 255.0f;
+
+        return glm::vec4(
+            (float)(color & 0xFF) * inv,
+            (float)((color >> 8) & 0xFF) * inv,
+            (float)((color >> 16) & 0xFF) * inv,
+            (float)(color >> 24) * inv);
+    }
+
+    inline uint32_t PackChannel(float value)
+    {
+        value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+        return (uint32_t)(value * 255.0f + 0.5f);
+    }
+
+    inline uint32_t PackColor(const glm::vec4 &color)
+    {
+        return PackChannel(color.r) | (PackChannel(color.g) << 8) | (PackChannel(color.b) << 16) | (PackChannel(color.a) << 24);
+    }
+
+    inline int64_t ToFixed(float value)
+    {
+        // fmin/fmax also turn NaN into a bound
+        value = std::fmax(std::fmin(value * (float)kSubpixels, kMaxFixed), -kMaxFixed);
+        return (int64_t)std::lrint(value);
+    }
+
+    inline float Smoothstep(float edge0, float edge1, float x)
+    {
+        float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+        return t * t * (3.0f - 2.0f * t);
+    }
+
+    // Texel index on one axis, -1 when it falls on the border
+    inline int AddressTexel(int i, int size, TextureAddressMode mode)
+    {
+        switch (mode) {
+            case TextureAddressMode::Repeat:
+            {
+                i %= size;
+                return i < 0 ? i + size : i;
+            }
+
+            case TextureAddressMode::MirrorRepeat:
+            {
+                int period = size * 2;
+                i %= period;
+                i = i < 0 ? i + period : i;
+                return i < size ? i : period - 1 - i;
+            }
+
+            case TextureAddressMode::ClampBorder:
+                return (i < 0 || i >= size) ? -1 : i;
+
+            case TextureAddressMode::MirrorClampEdge:
+                return std::min(i < 0 ? -1 - i : i, size - 1);
+
+            default:
+                return std::clamp(i, 0, size - 1);
+        }
+    }
+
+    inline glm::vec4 FetchTexel(const SoftwareImage &image, int x, int y)
+    {
+        x = AddressTexel(x, image.width, image.sampler.AddressModeU);
+        y = AddressTexel(y, image.height, image.sampler.AddressModeV);
+
+        // Transparent black border, as the samplers are created
+        if (x < 0 || y < 0) {
+            return glm::vec4(0.0f);
+        }
+
+        return UnpackColor(image.pixels[(size_t)y * image.width + x]);
+    }
+
+    // No mipmaps, the magnification filter is used at any scale
+    glm::vec4 Sample(const SoftwareImage &image, float u, float v)
+    {
+        if (image.width == 0 || image.height == 0) {
+            return glm::vec4(0.0f);
+        }
+
+        float x = std::fmax(std::fmin(u * image.width, kMaxFixed), -kMaxFixed);
+        float y = std::fmax(std::fmin(v * image.height, kMaxFixed), -kMaxFixed);
+
+        if (image.sampler.FilterMag == TextureFilter::Nearest) {
+            return FetchTexel(image, (int)std::floor(x), (int)std::floor(y));
+        }
+
+        x -= 0.5f;
+        y -= 0.5f;
+
+        float x0 = std::floor(x);
+        float y0 = std::floor(y);
+        float fx = x - x0;
+        float fy = y - y0;
+
+        glm::vec4 c00 = FetchTexel(image, (int)x0, (int)y0);
+        glm::vec4 c10 = FetchTexel(image, (int)x0 + 1, (int)y0);
+        glm::vec4 c01 = FetchTexel(image, (int)x0, (int)y0 + 1);
+        glm::vec4 c11 = FetchTexel(image, (int)x0 + 1, (int)y0 + 1);
+
+        glm::vec4 color;
+        for (int i = 0; i < 4; i++) {
+            float top = c00[i] + (c10[i] - c00[i]) * fx;
+            float bottom = c01[i] + (c11[i] - c01[i]) * fx;
+
+            color[i] = top + (bottom - top) * fy;
+        }
+
+        return color;
+    }
+
+    inline float GetBlendFactor(BlendFactor factor, const glm::vec4 &src, const glm::vec4 &dst, int channel)
+    {
+        switch (factor) {
+            case BlendFactor::BLEND_FACTOR_ONE:
+                return 1.0f;
+            case BlendFactor::BLEND_FACTOR_SRC_COLOR:
+                return src[channel];
+            case BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_COLOR:
+                return 1.0f - src[channel];
+            case BlendFactor::BLEND_FACTOR_DST_COLOR:
+                return dst[channel];
+            case BlendFactor::BLEND_FACTOR_ONE_MINUS_DST_COLOR:
+                return 1.0f - dst[channel];
+            case BlendFactor::BLEND_FACTOR_SRC_ALPHA:
+                return src.a;
+            case BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA:
+                return 1.0f - src.a;
+            case BlendFactor::BLEND_FACTOR_DST_ALPHA:
+                return dst.a;
+            case BlendFactor::BLEND_FACTOR_ONE_MINUS_DST_ALPHA:
+                return 1.0f - dst.a;
+            case BlendFactor::BLEND_FACTOR_SRC_ALPHA_SATURATE:
+                return channel == 3 ? 1.0f : std::min(src.a, 1.0f - dst.a);
+
+            // Blend constants are never set and stay zero, like in the GPU pipelines
+            case BlendFactor::BLEND_FACTOR_ONE_MINUS_CONSTANT_COLOR:
+            case BlendFactor::BLEND_FACTOR_ONE_MINUS_CONSTANT_ALPHA:
+                return 1.0f;
+
+            // The fragment shaders have no second output either
+            default:
+                return 0.0f;
+        }
+    }
+
+    inline float BlendChannel(BlendOp op, float src, float dst, float srcFactor, float dstFactor)
+    {
+        switch (op) {
+            case BlendOp::BLEND_OP_SUBTRACT:
+                return src * srcFactor - dst * dstFactor;
+            case BlendOp::BLEND_OP_REVERSE_SUBTRACT:
+                return dst * dstFactor - src * srcFactor;
+            case BlendOp::BLEND_OP_MIN:
+                return std::min(src, dst);
+            case BlendOp::BLEND_OP_MAX:
+                return std::max(src, dst);
+            default:
+                return src * srcFactor + dst * dstFactor;
+        }
+    }
+
+    inline glm::vec4 Blend(const TextureBlendInfo &info, glm::vec4 src, const glm::vec4 &dst)
+    {
+        // The output is clamped before blending on a unorm target
+        for (int i = 0; i < 4; i++) {
+            src[i] = std::clamp(src[i], 0.0f, 1.0f);
+        }
+
+        if (!info.Enable) {
+            return src;
+        }
+
+        glm::vec4 color;
+        for (int i = 0; i < 3; i++) {
+            color[i] = BlendChannel(info.ColorOp, src[i], dst[i], GetBlendFactor(info.SrcColor, src, dst, i), GetBlendFactor(info.DstColor, src, dst, i));
+        }
+
+        color.a = BlendChannel(info.AlphaOp, src.a, dst.a, GetBlendFactor(info.SrcAlpha, src, dst, 3), GetBlendFactor(info.DstAlpha, src, dst, 3));
+        return color;
+    }
+
+    // The result doesn't depend on what is already in the target
+    inline bool IsReplaceBlend(const TextureBlendInfo &info)
+    {
+        if (!info.Enable) {
+            return true;
+        }
+
+        return info.SrcColor == BlendFactor::BLEND_FACTOR_ONE && info.DstColor == BlendFactor::BLEND_FACTOR_ZERO && info.ColorOp == BlendOp::BLEND_OP_ADD &&
+               info.SrcAlpha == BlendFactor::BLEND_FACTOR_ONE && info.DstAlpha == BlendFactor::BLEND_FACTOR_ZERO && info.AlphaOp == BlendOp::BLEND_OP_ADD;
+    }
+
+    // Source-over with straight or premultiplied color, DefaultBlend::BLEND, PREMULTIPLIED and ImGui's blending
+    inline bool IsSourceOverBlend(const TextureBlendInfo &info)
+    {
+        return info.Enable && (info.SrcColor == BlendFactor::BLEND_FACTOR_SRC_ALPHA || info.SrcColor == BlendFactor::BLEND_FACTOR_ONE) &&
+               info.DstColor == BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA && info.ColorOp == BlendOp::BLEND_OP_ADD &&
+               (info.SrcAlpha == BlendFactor::BLEND_FACTOR_SRC_ALPHA || info.SrcAlpha == BlendFactor::BLEND_FACTOR_ONE) &&
+               info.DstAlpha == BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA && info.AlphaOp == BlendOp::BLEND_OP_ADD;
+    }
+
+    // One row of a triangle inside a tile, a channel per array so every pass below is a plain loop over floats
+    struct SoftwareSpan
+    {
+        float u[kTileSize];
+        float v[kTileSize];
+        float r[kTileSize];
+        float g[kTileSize];
+        float b[kTileSize];
+        float a[kTileSize];
+
+        // 0 where the fragment shader discards
+        float keep[kTileSize];
+    };
+
+    // Pixels [start, end) of count that pass all three edge tests, w holds the biased edge values at the first pixel
+    inline void CoverRow(const int64_t w[3], const int64_t step[3], int count, int &start, int &end)
+    {
+        start = 0;
+        end = count;
+
+        for (int e = 0; e < 3; e++) {
+            if (step[e] > 0) {
+                if (w[e] < 0) {
+                    start = (int)std::max<int64_t>(start, std::min<int64_t>((-w[e] + step[e] - 1) / step[e], count));
+                }
+            } else if (w[e] < 0) {
+                end = 0;
+            } else if (step[e] < 0) {
+                end = (int)std::min<int64_t>(end, w[e] / -step[e] + 1);
+            }
+        }
+    }
+
+    void FillSpan(SoftwareSpan &span, int count, const glm::vec4 &color)
+    {
+        for (int i = 0; i < count; i++) {
+            span.r[i] = color.r;
+            span.g[i] = color.g;
+            span.b[i] = color.b;
+            span.a[i] = color.a;
+            span.keep[i] = 1.0f;
+        }
+    }
+
+    // l0 and l1 are the weights of a and b at the first pixel, step0 and step1 their change per pixel
+    void InterpolateSpan(SoftwareSpan &span, int count, const SoftwareVertex &a, const SoftwareVertex &b, const SoftwareVertex &c, float l0, float step0, float l1, float step1)
+    {
+        // Locals, the vertices could alias the span as far as the compiler knows
+        const float au = a.texCoord.x, bu = b.texCoord.x, cu = c.texCoord.x;
+        const float av = a.texCoord.y, bv = b.texCoord.y, cv = c.texCoord.y;
+        const float ar = a.color.r, br = b.color.r, cr = c.color.r;
+        const float ag = a.color.g, bg = b.color.g, cg = c.color.g;
+        const float ab = a.color.b, bb = b.color.b, cb = c.color.b;
+        const float aa = a.color.a, ba = b.color.a, ca = c.color.a;
+
+        for (int i = 0; i < count; i++) {
+            float w0 = l0 + (float)i * step0;
+            float w1 = l1 + (float)i * step1;
+            float w2 = 1.0f - w0 - w1;
+
+            span.u[i] = w0 * au + w1 * bu + w2 * cu;
+            span.v[i] = w0 * av + w1 * bv + w2 * cv;
+            span.r[i] = w0 * ar + w1 * br + w2 * cr;
+            span.g[i] = w0 * ag + w1 * bg + w2 * cg;
+            span.b[i] = w0 * ab + w1 * bb + w2 * cb;
+            span.a[i] = w0 * aa + w1 * ba + w2 * ca;
+            span.keep[i] = 1.0f;
+        }
+    }
+
+    // image.frag and solid.frag, vertex alpha is applied twice on both paths as the shaders do
+    void ShadeSpan(const SoftwareDraw &draw, SoftwareSpan &span, int count)
+    {
+        // ImGui's shader is only color * texture
+        if (!draw.imgui && draw.variant == ShaderVariant::Square) {
+            for (int i = 0; i < count; i++) {
+                span.a[i] *= span.a[i];
+            }
+        } else if (!draw.imgui) {
+            // Distance to the rounded box, centered on the element. uiRadius is (top-left, top-right, bottom-left, bottom-right)
+            const float width = draw.uiSize.x, height = draw.uiSize.y;
+            const float halfWidth = width * 0.5f, halfHeight = height * 0.5f;
+            const float topLeft = draw.uiRadius.x, topRight = draw.uiRadius.y;
+            const float bottomLeft = draw.uiRadius.z, bottomRight = draw.uiRadius.w;
+
+            for (int i = 0; i < count; i++) {
+                float px = span.u[i] * width - halfWidth;
+                float py = span.v[i] * height - halfHeight;
+
+                float radius = px >= 0.0f ? (py >= 0.0f ? bottomRight : topRight) : (py >= 0.0f ? bottomLeft : topLeft);
+                radius = std::max(radius, 0.0f);
+
+                float qx = std::fabs(px) - halfWidth + radius;
+                float qy = std::fabs(py) - halfHeight + radius;
+                float ox = std::max(qx, 0.0f);
+                float oy = std::max(qy, 0.0f);
+                float dist = std::min(std::max(qx, qy), 0.0f) + std::sqrt(ox * ox + oy * oy) - radius;
+
+                float alpha = span.a[i] * (1.0f - Smoothstep(-kSmoothness, kSmoothness, dist));
+
+                span.keep[i] = alpha > 0.0f ? 1.0f : 0.0f;
+                span.a[i] *= alpha;
+            }
+        }
+
+        if (!draw.textured) {
+            return;
+        }
+
+        // Texel fetches are gathers with per-axis addressing, sampled a pixel at a time
+        for (int i = 0; i < count; i++) {
+            glm::vec4 texel = draw.image ? Sample(*draw.image, span.u[i], span.v[i]) : glm::vec4(0.0f);
+
+            span.r[i] *= texel.r;
+            span.g[i] *= texel.g;
+            span.b[i] *= texel.b;
+            span.a[i] *= texel.a;
+        }
+    }
+
+    inline float Saturate(float value)
+    {
+        return std::min(std::max(value, 0.0f), 1.0f);
+    }
+
+    inline uint32_t ToByte(float value)
+    {
+        // Clamped, so the signed conversion is exact and vectorizes
+        return (uint32_t)(int32_t)(Saturate(value) * 255.0f + 0.5f);
+    }
+
+    inline uint32_t PackBytes(float r, float g, float b, float a)
+    {
+        return ToByte(r) | (ToByte(g) << 8) | (ToByte(b) << 16) | (ToByte(a) << 24);
+    }
+
+    // Writes the span to row, same result as Blend() for every pixel
+    void BlendSpan(const TextureBlendInfo &info, const SoftwareSpan &span, int count, uint32_t *row)
+    {
+        if (IsReplaceBlend(info)) {
+            for (int i = 0; i < count; i++) {
+                uint32_t pixel = PackBytes(span.r[i], span.g[i], span.b[i], span.a[i]);
+                row[i] = span.keep[i] > 0.0f ? pixel : row[i];
+            }
+            return;
+        }
+
+        if (IsSourceOverBlend(info)) {
+            const float inv255 = 1.0f / 255.0f;
+
+            // The source factors are alpha or one, max(alpha, floor) picks them without a select per pixel
+            const float colorFloor = info.SrcColor == BlendFactor::BLEND_FACTOR_ONE ? 1.0f : 0.0f;
+            const float alphaFloor = info.SrcAlpha == BlendFactor::BLEND_FACTOR_ONE ? 1.0f : 0.0f;
+
+            for (int i = 0; i < count; i++) {
+                uint32_t dst = row[i];
+
+                float alpha = Saturate(span.a[i]);
+                float keep = (1.0f - alpha) * inv255;
+                float colorFactor = std::max(alpha, colorFloor);
+                float alphaFactor = std::max(alpha, alphaFloor);
+
+                float r = Saturate(span.r[i]) * colorFactor + (float)(int32_t)(dst & 0xFF) * keep;
+                float g = Saturate(span.g[i]) * colorFactor + (float)(int32_t)((dst >> 8) & 0xFF) * keep;
+                float b = Saturate(span.b[i]) * colorFactor + (float)(int32_t)((dst >> 16) & 0xFF) * keep;
+                float a = alpha * alphaFactor + (float)(int32_t)(dst >> 24) * keep;
+
+                uint32_t pixel = PackBytes(r, g, b, a);
+                row[i] = span.keep[i] > 0.0f ? pixel : dst;
+            }
+            return;
+        }
+
+        // Additive, modulate and custom states, rare enough to go through the factor lookups
+        for (int i = 0; i < count; i++) {
+            if (span.keep[i] > 0.0f) {
+                glm::vec4 src(span.r[i], span.g[i], span.b[i], span.a[i]);
+                row[i] = PackColor(Blend(info, src, UnpackColor(row[i])));
+            }
+        }
+    }
+
+    void ClearImage(SoftwareImage &image, uint32_t color)
+    {
+        std::fill(image.pixels.begin(), image.pixels.end(), color);
+    }
+} // namespace
+
+void Software::SetVertexFormat(VertexFormat format)
+{
+    m_VertexFormat = format;
+}
+
+void Software::SetSwapchainInfo(SwapchainInfo info)
+{
+    m_SwapchainInfo = info;
+}
+
+void Software::Init()
+{
+    CreateDefaultBlend();
+    SetRecordThreads(0);
+
+    // Same as the ImGui GPU backends' pipelines
+    m_ImGuiBlend = {
+        true,
+        BlendFactor::BLEND_FACTOR_SRC_ALPHA,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD
+    };
+
+    ImGui_Init();
+}
+
+void Software::CreateDefaultBlend()
+{
+    // NONE, no blending
+    // BLEND, dstRGB = (srcRGB * srcA) + (dstRGB * (1-srcA)), dstA = srcA + (dstA * (1-srcA))
+    // ADD, dstRGB = (srcRGB * srcA) + dstRGB, dstA = dstA
+    // MOD, dstRGB = srcRGB * dstRGB, dstA = dstA
+    // MUL dstRGB = (srcRGB * dstRGB) + (dstRGB * (1-srcA)), dstA = (srcA * dstA) + (dstA * (1-srcA))
+    // PREMULTIPLIED, dstRGB = srcRGB + (dstRGB * (1-srcA)), dstA = srcA + (dstA * (1-srcA))
+
+    TextureBlendInfo blendNone = {
+        true,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ZERO,
+        BlendOp::BLEND_OP_ADD,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ZERO,
+        BlendOp::BLEND_OP_ADD
+    };
+
+    TextureBlendInfo blendBlend = {
+        true,
+        BlendFactor::BLEND_FACTOR_SRC_ALPHA,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD
+    };
+
+    TextureBlendInfo blendAdd = {
+        true,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendOp::BLEND_OP_ADD,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendOp::BLEND_OP_ADD
+    };
+
+    TextureBlendInfo blendMod = {
+        true,
+        BlendFactor::BLEND_FACTOR_DST_COLOR,
+        BlendFactor::BLEND_FACTOR_ZERO,
+        BlendOp::BLEND_OP_ADD,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ZERO,
+        BlendOp::BLEND_OP_ADD
+    };
+
+    TextureBlendInfo blendMul = {
+        true,
+        BlendFactor::BLEND_FACTOR_SRC_COLOR,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD,
+        BlendFactor::BLEND_FACTOR_SRC_ALPHA,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD
+    };
+
+    TextureBlendInfo blendPremultiplied = {
+        true,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD
+    };
+
+    CreateBlendState(blendNone);
+    CreateBlendState(blendBlend);
+    CreateBlendState(blendAdd);
+    CreateBlendState(blendMod);
+    CreateBlendState(blendMul);
+    CreateBlendState(blendPremultiplied);
+}
+
+void Software::Shutdown()
+{
+    m_RasterPool.Stop();
+
+    while (m_RenderTargets.size()) {
+        DestroyRenderTarget(m_RenderTargets.begin()->first);
+    }
+
+    ImGui_DeInit();
+
+    m_Backbuffer = {};
+    m_Bins.clear();
+}
+
+void Software::ReInit()
+{
+}
+
+bool Software::NeedReinit()
+{
+    return false;
+}
+
+bool Software::BeginFrame()
+{
+    auto rect = Graphics::NativeWindow::Get()->GetWindowSize();
+    if (!rect.Width || !rect.Height) {
+        return false;
+    }
+
+    if (m_Backbuffer.width != rect.Width || m_Backbuffer.height != rect.Height) {
+        m_Backbuffer.width = rect.Width;
+        m_Backbuffer.height = rect.Height;
+        m_Backbuffer.pixels.assign((size_t)rect.Width * rect.Height, 0);
+
+        m_PresentedHash = 0;
+    }
+
+    return true;
+}
+
+void Software::EndFrame()
+{
+    FlushQueue();
+
+    // The rasterizer is the GPU here, its passes finish before they return
+    auto imgui = std::chrono::steady_clock::now();
+    DrawImGui(m_Backbuffer);
+
+    m_GpuTimings.valid = true;
+    m_GpuTimings.imgui = MillisecondsSince(imgui);
+    m_GpuTimings.total = m_GpuTimings.targets + m_GpuTimings.main + m_GpuTimings.imgui;
+
+    if (m_CaptureRequested) {
+        m_CaptureRequested = false;
+        m_CaptureRect = { 0, 0, m_Backbuffer.width, m_Backbuffer.height };
+        m_Capture.resize(m_Backbuffer.pixels.size() * 4);
+
+        for (size_t i = 0; i < m_Backbuffer.pixels.size(); i++) {
+            uint32_t pixel = m_Backbuffer.pixels[i];
+
+            m_Capture[i * 4 + 0] = (uint8_t)(pixel & 0xFF);
+            m_Capture[i * 4 + 1] = (uint8_t)((pixel >> 8) & 0xFF);
+            m_Capture[i * 4 + 2] = (uint8_t)((pixel >> 16) & 0xFF);
+            m_Capture[i * 4 + 3] = (uint8_t)(pixel >> 24);
+        }
+    }
+
+    Present();
+
+    m_PresentedHash = m_FrameHash;
+    m_FrameHash = 0;
+}
+
+void Software::Present()
+{
+    // Headless frames only live in the backbuffer, for ReadCapture
+    if (m_SwapchainInfo.headless) {
+        return;
+    }
+
+    SDL_Window  *window = Graphics::NativeWindow::Get()->GetWindow();
+    SDL_Surface *surface = SDL_GetWindowSurface(window);
+    if (surface == nullptr) {
+        throw Exceptions::EstException("Failed to get window surface");
+    }
+
+    int width = std::min(surface->w, m_Backbuffer.width);
+    int height = std::min(surface->h, m_Backbuffer.height);
+
+    if (SDL_MUSTLOCK(surface) && SDL_LockSurface(surface) != 0) {
+        throw Exceptions::EstException("Failed to lock window surface");
+    }
+
+    // ABGR8888 is a packed format, it matches the R-in-low-byte pixels on any endianness
+    SDL_ConvertPixels(
+        width,
+        height,
+        SDL_PIXELFORMAT_ABGR8888,
+        m_Backbuffer.pixels.data(),
+        m_Backbuffer.width * 4,
+        surface->format->format,
+        surface->pixels,
+        surface->pitch);
+
+    if (SDL_MUSTLOCK(surface)) {
+        SDL_UnlockSurface(surface);
+    }
+
+    SDL_UpdateWindowSurface(window);
+}
+
+void Software::WaitForPresent()
+{
+    // Frames are finished by the time EndFrame returns
+}
+
+void Software::Push(SubmitInfo &info)
+{
+    if (m_CurrentTarget != kBackbuffer) {
+        m_RenderTargets[m_CurrentTarget].submitInfos.push_back(info);
+        return;
+    }
+
+    m_SubmitInfos.push_back(info);
+}
+
+void Software::FlushQueue()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // A layer nested in another layer is activated after its parent, so walk backwards
+    for (auto it = m_TargetOrder.rbegin(); it != m_TargetOrder.rend(); it++) {
+        auto target = m_RenderTargets.find(*it);
+        if (target == m_RenderTargets.end() || target->second.submitInfos.size() == 0) {
+            continue;
+        }
+
+        auto &info = target->second;
+
+        ClearImage(info.image, 0);
+        DrawQueue(info.submitInfos, info.image, info.rect);
+    }
+
+    m_TargetOrder.clear();
+
+    m_GpuTimings.targets = MillisecondsSince(start);
+    start = std::chrono::steady_clock::now();
+
+    // Opaque black, as the GPU backends clear
+    ClearImage(m_Backbuffer, 0xFF000000);
+    DrawQueue(m_SubmitInfos, m_Backbuffer, { 0, 0, m_Backbuffer.width, m_Backbuffer.height });
+
+    m_GpuTimings.main = MillisecondsSince(start);
+}
+
+void Software::DrawQueue(std::vector<SubmitInfo> &queue, SoftwareImage &target, Rect rect)
+{
+    if (queue.size() == 0) {
+        return;
+    }
+
+    std::stable_sort(queue.begin(), queue.end(), [](const SubmitInfo &a, const SubmitInfo &b) {
+        return a.zIndex < b.zIndex;
+    });
+
+    bool compact = m_VertexFormat == VertexFormat::Compact;
+
+    m_Draws.clear();
+    m_Triangles.clear();
+
+    for (auto &info : queue) {
+        // Scissor in target pixels, clamped to the target
+        int x0 = std::max(info.clipRect.X - rect.X, 0);
+        int y0 = std::max(info.clipRect.Y - rect.Y, 0);
+        int x1 = std::min(info.clipRect.X + info.clipRect.Width - rect.X, target.width);
+        int y1 = std::min(info.clipRect.Y + info.clipRect.Height - rect.Y, target.height);
+
+        if (x1 <= x0 || y1 <= y0) {
+            continue;
+        }
+
+        SoftwareDraw draw = {};
+        draw.textured = info.fragmentType == ShaderFragmentType::Image;
+        draw.image = draw.textured ? (const SoftwareImage *)info.image : nullptr;
+        draw.blend = &m_BlendStates[IsOpaque(info) ? DefaultBlend::NONE : info.alphablend];
+        draw.variant = GetShaderVariant(info);
+        draw.imgui = false;
+        draw.uiSize = info.uiSize;
+        draw.uiRadius = info.uiRadius;
+        draw.clip = { x0, y0, x1 - x0, y1 - y0 };
+
+        uint32_t drawIndex = (uint32_t)m_Draws.size();
+        m_Draws.push_back(draw);
+
+        // matrix * (pos - pivot) + pivot + offset, as position.vert
+        auto &t = info.transform;
+        auto  transform = [&](glm::vec2 pos) {
+            float x = pos.x - info.pivot.x;
+            float y = pos.y - info.pivot.y;
+
+            return glm::vec2(
+                t.x * x + t.z * y + info.pivot.x + info.offset.x - rect.X,
+                t.y * x + t.w * y + info.pivot.y + info.offset.y - rect.Y);
+        };
+
+        auto vertex = [&](const Vertex &source) {
+            Vertex input = source;
+
+            // Go through the same quantization the GPU backends upload
+            if (compact) {
+                auto packed = ToCompactVertex(source);
+
+                input.pos = glm::vec2(packed.pos[0] / kCompactSubpixels, packed.pos[1] / kCompactSubpixels);
+                input.texCoord = glm::vec2(packed.texCoord[0] / 65535.0f, packed.texCoord[1] / 65535.0f);
+            }
+
+            SoftwareVertex output;
+            output.pos = transform(input.pos);
+            output.texCoord = input.texCoord;
+            output.color = UnpackColor(input.color);
+
+            return output;
+        };
+
+        for (size_t i = 0; i + 2 < info.indices.size(); i += 3) {
+            SoftwareTriangle triangle;
+            triangle.draw = drawIndex;
+
+            bool valid = true;
+            for (int k = 0; k < 3; k++) {
+                uint16_t index = info.indices[i + k];
+                if (index >= info.vertices.size()) {
+                    valid = false;
+                    break;
+                }
+
+                triangle.v[k] = vertex(info.vertices[index]);
+            }
+
+            if (valid) {
+                m_Triangles.push_back(triangle);
+            }
+        }
+    }
+
+    Rasterize(target);
+
+    queue.clear();
+}
+
+void Software::DrawImGui(SoftwareImage &target)
+{
+    ImDrawData *data = m_ImGuiDrawData ? m_ImGuiDrawData : ImGui::GetDrawData();
+    if (data == nullptr || data->CmdListsCount == 0) {
+        return;
+    }
+
+    ImVec2 origin = data->DisplayPos;
+    ImVec2 scale = data->FramebufferScale;
+
+    m_Draws.clear();
+    m_Triangles.clear();
+
+    for (int n = 0; n < data->CmdListsCount; n++) {
+        const ImDrawList *list = data->CmdLists[n];
+
+        for (int c = 0; c < list->CmdBuffer.Size; c++) {
+            const ImDrawCmd &cmd = list->CmdBuffer[c];
+
+            if (cmd.UserCallback != nullptr) {
+                if (cmd.UserCallback != ImDrawCallback_ResetRenderState) {
+                    cmd.UserCallback(list, &cmd);
+                }
+                continue;
+            }
+
+            int x0 = std::max((int)((cmd.ClipRect.x - origin.x) * scale.x), 0);
+            int y0 = std::max((int)((cmd.ClipRect.y - origin.y) * scale.y), 0);
+            int x1 = std::min((int)((cmd.ClipRect.z - origin.x) * scale.x), target.width);
+            int y1 = std::min((int)((cmd.ClipRect.w - origin.y) * scale.y), target.height);
+
+            if (x1 <= x0 || y1 <= y0) {
+                continue;
+            }
+
+            SoftwareDraw draw = {};
+            draw.image = (const SoftwareImage *)cmd.GetTexID();
+            draw.blend = &m_ImGuiBlend;
+            draw.variant = ShaderVariant::Square;
+            draw.textured = true;
+            draw.imgui = true;
+            draw.clip = { x0, y0, x1 - x0, y1 - y0 };
+
+            uint32_t drawIndex = (uint32_t)m_Draws.size();
+            m_Draws.push_back(draw);
+
+            for (unsigned int i = 0; i + 2 < cmd.ElemCount; i += 3) {
+                SoftwareTriangle triangle;
+                triangle.draw = drawIndex;
+
+                for (int k = 0; k < 3; k++) {
+                    const ImDrawVert &source = list->VtxBuffer[cmd.VtxOffset + list->IdxBuffer[cmd.IdxOffset + i + k]];
+
+                    triangle.v[k].pos = glm::vec2((source.pos.x - origin.x) * scale.x, (source.pos.y - origin.y) * scale.y);
+                    triangle.v[k].texCoord = glm::vec2(source.uv.x, source.uv.y);
+                    triangle.v[k].color = UnpackColor(source.col);
+                }
+
+                m_Triangles.push_back(triangle);
+            }
+        }
+    }
+
+    Rasterize(target);
+}
+
+void Software::Rasterize(SoftwareImage &target)
+{
+    if (m_Triangles.size() == 0 || target.width == 0 || target.height == 0) {
+        return;
+    }
+
+    m_TilesX = (target.width + kTileSize - 1) / kTileSize;
+    m_TilesY = (target.height + kTileSize - 1) / kTileSize;
+
+    uint32_t tiles = (uint32_t)(m_TilesX * m_TilesY);
+    if (m_Bins.size() < tiles) {
+        m_Bins.resize(tiles);
+    }
+
+    for (uint32_t i = 0; i < tiles; i++) {
+        m_Bins[i].clear();
+    }
+
+    // Bins keep submission order, so each tile still blends back to front
+    for (uint32_t i = 0; i < (uint32_t)m_Triangles.size(); i++) {
+        auto &triangle = m_Triangles[i];
+        auto &clip = m_Draws[triangle.draw].clip;
+
+        int64_t minX = std::min({ ToFixed(triangle.v[0].pos.x), ToFixed(triangle.v[1].pos.x), ToFixed(triangle.v[2].pos.x) });
+        int64_t minY = std::min({ ToFixed(triangle.v[0].pos.y), ToFixed(triangle.v[1].pos.y), ToFixed(triangle.v[2].pos.y) });
+        int64_t maxX = std::max({ ToFixed(triangle.v[0].pos.x), ToFixed(triangle.v[1].pos.x), ToFixed(triangle.v[2].pos.x) });
+        int64_t maxY = std::max({ ToFixed(triangle.v[0].pos.y), ToFixed(triangle.v[1].pos.y), ToFixed(triangle.v[2].pos.y) });
+
+        int x0 = (int)std::max<int64_t>(minX >> kSubpixelBits, clip.X);
+        int y0 = (int)std::max<int64_t>(minY >> kSubpixelBits, clip.Y);
+        int x1 = (int)std::min<int64_t>((maxX + kSubpixels - 1) >> kSubpixelBits, clip.X + clip.Width);
+        int y1 = (int)std::min<int64_t>((maxY + kSubpixels - 1) >> kSubpixelBits, clip.Y + clip.Height);
+
+        if (x1 <= x0 || y1 <= y0) {
+            continue;
+        }
+
+        for (int ty = y0 / kTileSize; ty <= (y1 - 1) / kTileSize; ty++) {
+            for (int tx = x0 / kTileSize; tx <= (x1 - 1) / kTileSize; tx++) {
+                m_Bins[ty * m_TilesX + tx].push_back(i);
+            }
+        }
+    }
+
+    std::atomic<uint32_t> next(0);
+    auto                  job = [&](uint32_t) {
+        for (uint32_t tile = next++; tile < tiles; tile = next++) {
+            if (m_Bins[tile].size()) {
+                RasterizeTile(target, tile);
+            }
+        }
+    };
+
+    uint32_t threads = std::min(m_RasterPool.GetThreads(), tiles);
+    if (threads <= 1) {
+        job(0);
+        return;
+    }
+
+    m_RasterPool.Run(threads, job);
+}
+
+void Software::RasterizeTile(SoftwareImage &target, uint32_t tile)
+{
+    int tileX0 = (int)(tile % m_TilesX) * kTileSize;
+    int tileY0 = (int)(tile / m_TilesX) * kTileSize;
+    int tileX1 = std::min(tileX0 + kTileSize, target.width);
+    int tileY1 = std::min(tileY0 + kTileSize, target.height);
+
+    for (uint32_t index : m_Bins[tile]) {
+        auto &triangle = m_Triangles[index];
+        auto &draw = m_Draws[triangle.draw];
+
+        const SoftwareVertex *a = &triangle.v[0];
+        const SoftwareVertex *b = &triangle.v[1];
+        const SoftwareVertex *c = &triangle.v[2];
+
+        int64_t ax = ToFixed(a->pos.x), ay = ToFixed(a->pos.y);
+        int64_t bx = ToFixed(b->pos.x), by = ToFixed(b->pos.y);
+        int64_t cx = ToFixed(c->pos.x), cy = ToFixed(c->pos.y);
+
+        int64_t area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+        if (area == 0) {
+            continue;
+        }
+
+        // Culling is off on the GPU too, wind every triangle the same way
+        if (area < 0) {
+            std::swap(b, c);
+            std::swap(bx, cx);
+            std::swap(by, cy);
+            area = -area;
+        }
+
+        int x0 = std::max({ tileX0, draw.clip.X, (int)(std::min({ ax, bx, cx }) >> kSubpixelBits) });
+        int y0 = std::max({ tileY0, draw.clip.Y, (int)(std::min({ ay, by, cy }) >> kSubpixelBits) });
+        int x1 = std::min({ tileX1, draw.clip.X + draw.clip.Width, (int)((std::max({ ax, bx, cx }) + kSubpixels - 1) >> kSubpixelBits) });
+        int y1 = std::min({ tileY1, draw.clip.Y + draw.clip.Height, (int)((std::max({ ay, by, cy }) + kSubpixels - 1) >> kSubpixelBits) });
+
+        if (x1 <= x0 || y1 <= y0) {
+            continue;
+        }
+
+        // Edge functions of bc, ca and ab are the weights of a, b and c
+        int64_t fromX[3] = { bx, cx, ax };
+        int64_t fromY[3] = { by, cy, ay };
+        int64_t toX[3] = { cx, ax, bx };
+        int64_t toY[3] = { cy, ay, by };
+
+        int64_t stepX[3], stepY[3], rowStart[3], bias[3];
+
+        int64_t sampleX = (int64_t)x0 * kSubpixels + kSubpixels / 2;
+        int64_t sampleY = (int64_t)y0 * kSubpixels + kSubpixels / 2;
+
+        for (int e = 0; e < 3; e++) {
+            int64_t dx = toX[e] - fromX[e];
+            int64_t dy = toY[e] - fromY[e];
+
+            stepX[e] = -dy * kSubpixels;
+            stepY[e] = dx * kSubpixels;
+            rowStart[e] = dx * (sampleY - fromY[e]) - dy * (sampleX - fromX[e]);
+
+            // Top-left rule: samples exactly on a left or top edge belong to this triangle only
+            bool topLeft = stepX[e] > 0 || (stepX[e] == 0 && stepY[e] > 0);
+            bias[e] = topLeft ? 0 : -1;
+        }
+
+        float invArea = 1.0f / (float)area;
+
+        // Flat solid quads are most of a UI, shade them once and fill spans
+        bool constant = !draw.textured && draw.variant == ShaderVariant::Square && a->color == b->color && a->color == c->color;
+        bool replace = IsReplaceBlend(*draw.blend);
+
+        glm::vec4 flat = a->color;
+        flat.a *= flat.a;
+
+        uint32_t flatPixel = PackColor(Blend(*draw.blend, flat, glm::vec4(0.0f)));
+
+        SoftwareSpan span;
+
+        for (int y = y0; y < y1; y++) {
+            int64_t w[3] = { rowStart[0] + bias[0], rowStart[1] + bias[1], rowStart[2] + bias[2] };
+            rowStart[0] += stepY[0];
+            rowStart[1] += stepY[1];
+            rowStart[2] += stepY[2];
+
+            // The covered pixels of a row are contiguous, only they get shaded
+            int start, end;
+            CoverRow(w, stepX, x1 - x0, start, end);
+
+            if (end <= start) {
+                continue;
+            }
+
+            int       count = end - start;
+            uint32_t *row = target.pixels.data() + (size_t)y * target.width + x0 + start;
+
+            if (constant && replace) {
+                std::fill(row, row + count, flatPixel);
+                continue;
+            }
+
+            if (constant) {
+                FillSpan(span, count, flat);
+            } else {
+                float l0 = (float)(w[0] - bias[0] + start * stepX[0]) * invArea;
+                float l1 = (float)(w[1] - bias[1] + start * stepX[1]) * invArea;
+
+                InterpolateSpan(span, count, *a, *b, *c, l0, (float)stepX[0] * invArea, l1, (float)stepX[1] * invArea);
+                ShadeSpan(draw, span, count);
+            }
+
+            BlendSpan(*draw.blend, span, count, row);
+        }
+    }
+}
+
+RenderTargetHandle Software::CreateRenderTarget(Rect rect)
+{
+    if (rect.Width <= 0 || rect.Height <= 0) {
+        throw Exceptions::EstException("Invalid render target size");
+    }
+
+    SoftwareRenderTarget target = {};
+    target.rect = rect;
+    target.image.width = rect.Width;
+    target.image.height = rect.Height;
+    target.image.pixels.assign((size_t)rect.Width * rect.Height, 0);
+
+    target.image.sampler.FilterMag = TextureFilter::Linear;
+    target.image.sampler.FilterMin = TextureFilter::Linear;
+    target.image.sampler.AddressModeU = TextureAddressMode::ClampEdge;
+    target.image.sampler.AddressModeV = TextureAddressMode::ClampEdge;
+    target.image.sampler.AddressModeW = TextureAddressMode::ClampEdge;
+
+    RenderTargetHandle handle = ++m_RenderTargetId;
+    m_RenderTargets[handle] = std::move(target);
+
+    return handle;
+}
+
+void Software::DestroyRenderTarget(RenderTargetHandle handle)
+{
+    auto it = m_RenderTargets.find(handle);
+    if (it == m_RenderTargets.end()) {
+        return;
+    }
+
+    m_RenderTargets.erase(it);
+
+    m_TargetOrder.erase(std::remove(m_TargetOrder.begin(), m_TargetOrder.end(), handle), m_TargetOrder.end());
+    if (m_CurrentTarget == handle) {
+        m_CurrentTarget = kBackbuffer;
+    }
+}
+
+void Software::SetRenderTarget(RenderTargetHandle handle)
+{
+    if (handle != kBackbuffer) {
+        if (m_RenderTargets.find(handle) == m_RenderTargets.end()) {
+            throw Exceptions::EstException("Invalid render target");
+        }
+
+        if (std::find(m_TargetOrder.begin(), m_TargetOrder.end(), handle) == m_TargetOrder.end()) {
+            m_TargetOrder.push_back(handle);
+        }
+    }
+
+    m_CurrentTarget = handle;
+}
+
+const void *Software::GetRenderTargetImage(RenderTargetHandle handle)
+{
+    auto it = m_RenderTargets.find(handle);
+    if (it == m_RenderTargets.end()) {
+        return nullptr;
+    }
+
+    return &it->second.image;
+}
+
+bool Software::Represent(uint64_t hash)
+{
+    // The backbuffer is only rewritten by EndFrame, it still holds the last frame
+    if (hash != 0 && hash == m_PresentedHash) {
+        Present();
+        return true;
+    }
+
+    m_FrameHash = hash;
+    return false;
+}
+
+void Software::SetClearColor(glm::vec4 color)
+{
+}
+
+void Software::SetClearDepth(float depth)
+{
+}
+
+void Software::SetClearStencil(uint32_t stencil)
+{
+}
+
+void Software::RequestCapture()
+{
+    m_CaptureRequested = true;
+}
+
+bool Software::ReadCapture(std::vector<uint8_t> &pixels, int &width, int &height)
+{
+    if (m_Capture.empty()) {
+        return false;
+    }
+
+    pixels = std::move(m_Capture);
+    width = m_CaptureRect.Width;
+    height = m_CaptureRect.Height;
+
+    m_Capture.clear();
+    return true;
+}
+
+GpuTimings Software::GetGpuTimings()
+{
+    return m_GpuTimings;
+}
+
+void Software::SetImGuiDrawData(ImDrawData *data)
+{
+    m_ImGuiDrawData = data;
+}
+
+void Software::SetRecordThreads(uint32_t threads)
+{
+    // Tiles are independent, every core helps
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    m_RasterPool.Stop();
+    m_RasterPool.Start(threads);
+}
+
+BlendHandle Software::CreateBlendState(TextureBlendInfo blendInfo)
+{
+    m_BlendStates[m_BlendId] = blendInfo;
+    return m_BlendId++;
+}
+
+void Software::ImGui_Init()
+{
+    ImGui::CreateContext();
+
+    auto window = Graphics::NativeWindow::Get();
+    ImGui_ImplSDL2_InitForOther(window->GetWindow());
+    window->AddSDLCallback([=](SDL_Event &ev) {
+        ImGui_ImplSDL2_ProcessEvent(&ev);
+    });
+
+    ImGuiIO &io = ImGui::GetIO();
+    io.BackendRendererName = "EstEngine_Software";
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+
+    unsigned char *pixels = nullptr;
+    int            width = 0;
+    int            height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    m_FontAtlas.width = width;
+    m_FontAtlas.height = height;
+    m_FontAtlas.pixels.resize((size_t)width * height);
+
+    for (size_t i = 0; i < m_FontAtlas.pixels.size(); i++) {
+        m_FontAtlas.pixels[i] = (uint32_t)pixels[i * 4] | ((uint32_t)pixels[i * 4 + 1] << 8) | ((uint32_t)pixels[i * 4 + 2] << 16) | ((uint32_t)pixels[i * 4 + 3] << 24);
+    }
+
+    io.Fonts->SetTexID((ImTextureID)&m_FontAtlas);
+}
+
+void Software::ImGui_DeInit()
+{
+    ImGui_ImplSDL2_Shutdown();
+
+    ImGui::GetIO().BackendRendererName = nullptr;
+    ImGui::DestroyContext();
+
+    m_FontAtlas = {};
+}
+
+void Software::ImGui_NewFrame()
+{
+    ImGui_ImplSDL2_NewFrame();
+    ImGui::NewFrame();
+}
+
+void Software::ImGui_EndFrame()
+{
+    ImGui::EndFrame();
+    ImGui::Render();
+}
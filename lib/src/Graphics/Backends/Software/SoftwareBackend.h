@@ -0,0 +1,151 @@
+#ifndef __SOFTWAREBACKEND_H_
+#define __SOFTWAREBACKEND_H_
+#include "../WorkerPool.h"
+#include <Graphics/GraphicsBackendBase.h>
+#include <Graphics/GraphicsTexture2D.h>
+#include <map>
+#include <vector>
+
+namespace Graphics {
+    namespace Backends {
+        // RGBA8 pixels, R in the low byte like Vertex::color, row 0 at the top
+        struct SoftwareImage
+        {
+            int                   width = 0;
+            int                   height = 0;
+            std::vector<uint32_t> pixels;
+            TextureSamplerInfo    sampler;
+        };
+
+        struct SoftwareRenderTarget
+        {
+            Rect                    rect;
+            SoftwareImage           image;
+            std::vector<SubmitInfo> submitInfos;
+        };
+
+        // Everything a triangle needs from its submission, shared by all of its triangles
+        struct SoftwareDraw
+        {
+            const SoftwareImage    *image;
+            const TextureBlendInfo *blend;
+            ShaderVariant           variant;
+            bool                    textured;
+            bool                    imgui;
+            glm::vec2               uiSize;
+            glm::vec4               uiRadius;
+            Rect                    clip;
+        };
+
+        struct SoftwareVertex
+        {
+            glm::vec2 pos;
+            glm::vec2 texCoord;
+            glm::vec4 color;
+        };
+
+        struct SoftwareTriangle
+        {
+            SoftwareVertex v[3];
+            uint32_t       draw;
+        };
+
+        class Software : public Base
+        {
+        public:
+            virtual ~Software() = default;
+
+            virtual void SetVertexFormat(VertexFormat format) override;
+            virtual void SetSwapchainInfo(SwapchainInfo info) override;
+
+            virtual void Init() override;
+            virtual void ReInit() override;
+            virtual void Shutdown() override;
+
+            virtual bool NeedReinit() override;
+
+            virtual bool BeginFrame() override;
+            virtual void EndFrame() override;
+
+            virtual void WaitForPresent() override;
+
+            virtual void ImGui_Init() override;
+            virtual void ImGui_DeInit() override;
+            virtual void ImGui_NewFrame() override;
+            virtual void ImGui_EndFrame() override;
+
+            virtual void Push(SubmitInfo &info) override;
+
+            virtual void SetClearColor(glm::vec4 color) override;
+            virtual void SetClearDepth(float depth) override;
+            virtual void SetClearStencil(uint32_t stencil) override;
+
+            virtual BlendHandle CreateBlendState(TextureBlendInfo blendInfo) override;
+
+            virtual RenderTargetHandle CreateRenderTarget(Rect rect) override;
+            virtual void               DestroyRenderTarget(RenderTargetHandle handle) override;
+            virtual void               SetRenderTarget(RenderTargetHandle handle) override;
+            virtual const void        *GetRenderTargetImage(RenderTargetHandle handle) override;
+
+            virtual bool Represent(uint64_t hash) override;
+
+            // Threads rasterizing tiles
+            virtual void SetRecordThreads(uint32_t threads) override;
+
+            virtual void RequestCapture() override;
+            virtual bool ReadCapture(std::vector<uint8_t> &pixels, int &width, int &height) override;
+
+            virtual GpuTimings GetGpuTimings() override;
+            virtual void       SetImGuiDrawData(ImDrawData *data) override;
+
+        private:
+            void CreateDefaultBlend();
+
+            void FlushQueue();
+            void DrawQueue(std::vector<SubmitInfo> &queue, SoftwareImage &target, Rect rect);
+            void DrawImGui(SoftwareImage &target);
+            void Rasterize(SoftwareImage &target);
+            void RasterizeTile(SoftwareImage &target, uint32_t tile);
+            void Present();
+
+            VertexFormat  m_VertexFormat = VertexFormat::Float;
+            SwapchainInfo m_SwapchainInfo;
+
+            SoftwareImage           m_Backbuffer;
+            std::vector<SubmitInfo> m_SubmitInfos;
+
+            std::map<BlendHandle, TextureBlendInfo> m_BlendStates;
+            BlendHandle                             m_BlendId = 0;
+
+            std::map<RenderTargetHandle, SoftwareRenderTarget> m_RenderTargets;
+            std::vector<RenderTargetHandle>                    m_TargetOrder;
+            RenderTargetHandle                                 m_CurrentTarget = kBackbuffer;
+            RenderTargetHandle                                 m_RenderTargetId = 0;
+
+            // Filled per queue, then rasterized tile by tile
+            std::vector<SoftwareDraw>          m_Draws;
+            std::vector<SoftwareTriangle>      m_Triangles;
+            std::vector<std::vector<uint32_t>> m_Bins;
+            int                                m_TilesX = 0;
+            int                                m_TilesY = 0;
+
+            SoftwareImage    m_FontAtlas;
+            TextureBlendInfo m_ImGuiBlend = {};
+
+            WorkerPool m_RasterPool;
+
+            GpuTimings m_GpuTimings;
+
+            ImDrawData *m_ImGuiDrawData = nullptr;
+
+            uint64_t m_FrameHash = 0;
+            uint64_t m_PresentedHash = 0;
+
+            bool                 m_CaptureRequested = false;
+            std::vector<uint8_t> m_Capture;
+            Rect                 m_CaptureRect = {};
+        };
+    } // namespace Backends
+} // namespace Graphics
+
+#endif
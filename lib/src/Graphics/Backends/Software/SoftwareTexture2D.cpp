@@ -0,0 +1,88 @@
+#include "SoftwareTexture2D.h"
+#include <Exceptions/EstException.h>
+#include <Graphics/Renderer.h>
+#include <Graphics/Utils/stb_image.h>
+#include <Misc/Filesystem.h>
+
+using namespace Graphics;
+
+SWTexture2D::SWTexture2D(TextureSamplerInfo samplerInfo)
+{
+    SamplerInfo = samplerInfo;
+}
+
+SWTexture2D::~SWTexture2D()
+{
+    // Draws reference the pixels directly, a pipelined frame still queued has to finish with them first
+    auto renderer = Graphics::Renderer::Get();
+    renderer->UnregisterTexture(GetId());
+
+    if (renderer->GetAPI() == Graphics::API::Software) {
+        renderer->Invoke([]() {});
+    }
+}
+
+void SWTexture2D::Load(std::filesystem::path path)
+{
+    if (Image.pixels.size()) {
+        throw Exceptions::EstException("Texture already loaded");
+    }
+
+    Path = path;
+
+    auto data = Misc::Filesystem::ReadFile(path);
+
+    Load((const char *)data.data(), data.size());
+}
+
+void SWTexture2D::Load(const char *buf, size_t size)
+{
+    if (Image.pixels.size()) {
+        throw Exceptions::EstException("Texture already loaded");
+    }
+
+    int width = 0, height = 0, channels = 0;
+
+    unsigned char *image_data = stbi_load_from_memory(
+        (const unsigned char *)buf,
+        (int)size,
+        &width,
+        &height,
+        &channels,
+        STBI_rgb_alpha);
+
+    if (!image_data) {
+        throw Exceptions::EstException("Failed to load texture");
+    }
+
+    Load((const char *)image_data, width, height);
+    stbi_image_free(image_data);
+}
+
+void SWTexture2D::Load(const char *pixbuf, uint32_t width, uint32_t height)
+{
+    if (Image.pixels.size()) {
+        throw Exceptions::EstException("Texture already loaded");
+    }
+
+    if (width == 0 || height == 0) {
+        throw Exceptions::EstException("Failed to load texture");
+    }
+
+    Opaque = IsOpaquePixels(pixbuf, width, height);
+
+    Image.width = (int)width;
+    Image.height = (int)height;
+    Image.sampler = SamplerInfo;
+    Image.pixels.resize((size_t)width * height);
+
+    const unsigned char *bytes = (const unsigned char *)pixbuf;
+    for (size_t i = 0; i < Image.pixels.size(); i++) {
+        Image.pixels[i] = (uint32_t)bytes[i * 4] | ((uint32_t)bytes[i * 4 + 1] << 8) | ((uint32_t)bytes[i * 4 + 2] << 16) | ((uint32_t)bytes[i * 4 + 3] << 24);
+    }
+}
+
+const void *SWTexture2D::GetId()
+{
+    return &Image;
+}
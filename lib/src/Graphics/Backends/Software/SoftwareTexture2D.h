@@ -0,0 +1,25 @@
+#ifndef __SOFTWARETEXTURE2D_H_
+#define __SOFTWARETEXTURE2D_H_
+
+#include "SoftwareBackend.h"
+#include <Graphics/GraphicsTexture2D.h>
+
+namespace Graphics {
+    class SWTexture2D : public Texture2D
+    {
+    public:
+        SWTexture2D(TextureSamplerInfo samplerInfo);
+        ~SWTexture2D() override;
+
+        void Load(std::filesystem::path path) override;
+        void Load(const char *buf, size_t size) override;
+        void Load(const char *pixbuf, uint32_t width, uint32_t height) override;
+
+        const void *GetId() override;
+
+    private:
+        Backends::SoftwareImage Image;
+    };
+} // namespace Graphics
+
+#endif
@@ -1,6 +1,7 @@
 #include "VulkanBackend.h"
 #include <Exceptions/EstException.h>
 #include <Graphics/NativeWindow.h>
+#include <Threads/JobSystem.h>
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
@@ -11,7 +12,7 @@
 #include "vkinit.h"
 
 #include "../../Shaders/image.spv.h"
-#include "../../Shaders/position.spv.h"
+#include "../../Shaders/position_indirect.spv.h"
 #include "../../Shaders/solid.spv.h"
 
 #include "../../ImguiBackends/imgui_impl_sdl2.h"
@@ -19,16 +20,34 @@
 
 using namespace Graphics::Backends;
 
-constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+// Query slots of VulkanFrame::queryPool, in the order they are written
+enum GpuTimestamp : uint32_t {
+    TimestampBegin = 0,
+    TimestampMainPass = 1,
+    TimestampImGui = 2,
+    TimestampEnd = 3,
+    TimestampCount = 4,
+};
+
 uint32_t           VkBlendOperatioId = 0;
 
 struct PushConstant
+{
+    glm::vec2 scale;
+    glm::vec2 translate;
+};
+
+// std430 layout of DrawParams in position_indirect.vert
+struct DrawParams
 {
     glm::vec4 ui_radius;
     glm::vec2 ui_size;
+    glm::vec2 pivot;
+    glm::vec4 transform;
+    glm::vec2 offset;
 
-    glm::vec2 scale;
-    glm::vec2 translate;
+    float depth;
+    float padding;
 };
 
 void Vulkan::Init()
@@ -39,6 +58,7 @@ void Vulkan::Init()
     InitFramebuffers();
     InitCommands();
     InitSyncStructures();
+    InitQueries();
     InitDescriptors();
     InitShaders();
     InitPipeline();
@@ -64,11 +84,31 @@ void Vulkan::ReInit()
         InitFramebuffers();
         InitCommands();
         InitSyncStructures();
+        InitQueries();
     } catch (const Exceptions::EstException &) {
         m_SwapchainReady = false;
     }
 }
 
+void Graphics::Backends::Vulkan::SetVertexFormat(VertexFormat format)
+{
+    if (m_Initialized) {
+        throw Exceptions::EstException("Vertex format must be set before Init");
+    }
+
+    m_VertexFormat = format;
+}
+
+void Graphics::Backends::Vulkan::SetSwapchainInfo(SwapchainInfo info)
+{
+    if (m_Initialized) {
+        throw Exceptions::EstException("Swapchain info must be set before Init");
+    }
+
+    info.framesInFlight = std::max(info.framesInFlight, 1u);
+    m_SwapchainInfo = info;
+}
+
 void Graphics::Backends::Vulkan::Shutdown()
 {
     if (m_Initialized) {
@@ -79,6 +119,11 @@ void Graphics::Backends::Vulkan::Shutdown()
         }
 
         ImGui_DeInit();
+        m_RecordPool.Stop();
+
+        while (m_RenderTargets.size()) {
+            DestroyRenderTarget(m_RenderTargets.begin()->first);
+        }
 
         for (auto &descriptor : m_Descriptors) {
             DestroyDescriptor(descriptor.get(), false);
@@ -90,7 +135,10 @@ void Graphics::Backends::Vulkan::Shutdown()
         m_DeletionQueue.flush();
 
         vkb::destroy_swapchain(m_Swapchain.swapchain);
-        vkDestroySurfaceKHR(m_Vulkan.vkbInstance.instance, m_Vulkan.surface, nullptr);
+
+        if (m_Vulkan.surface != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(m_Vulkan.vkbInstance.instance, m_Vulkan.surface, nullptr);
+        }
 
         vkb::destroy_device(m_Vulkan.vkbDevice);
         vkb::destroy_instance(m_Vulkan.vkbInstance);
@@ -113,6 +161,7 @@ void Vulkan::CreateInstance()
                                        .request_validation_layers(true)
                                        .require_api_version(1, 1, 0)
                                        .use_default_debug_messenger()
+                                       .set_headless(m_SwapchainInfo.headless)
                                        .build();
 
     if (!instance_builder_return) {
@@ -123,7 +172,8 @@ void Vulkan::CreateInstance()
 
     volkLoadInstance(vkb_instance.instance);
 
-    if (!SDL_Vulkan_CreateSurface(
+    // Headless instances have no surface extensions, the selector skips the present check without one
+    if (!m_SwapchainInfo.headless && !SDL_Vulkan_CreateSurface(
             Graphics::NativeWindow::Get()->GetWindow(),
             vkb_instance.instance,
             &m_Vulkan.surface)) {
@@ -137,6 +187,13 @@ void Vulkan::CreateInstance()
                                               .select()
                                               .value();
 
+    // Optional, selection only asks for what it requires so these are switched on by hand
+    VkPhysicalDeviceFeatures supported = {};
+    vkGetPhysicalDeviceFeatures(physical_device.physical_device, &supported);
+
+    physical_device.features.multiDrawIndirect = supported.multiDrawIndirect;
+    physical_device.features.drawIndirectFirstInstance = supported.drawIndirectFirstInstance;
+
     vkb::DeviceBuilder device_builder{ physical_device };
     vkb::Device        vkb_device = device_builder.build().value();
 
@@ -149,17 +206,48 @@ void Vulkan::CreateInstance()
     m_Vulkan.graphicsQueueFamily = queueFamily;
     m_Vulkan.vkbInstance = vkb_instance;
     m_Vulkan.vkbDevice = vkb_device;
+
+    m_Vulkan.indirectDraw = supported.multiDrawIndirect && supported.drawIndirectFirstInstance;
+    m_Vulkan.maxDrawIndirectCount = physical_device.properties.limits.maxDrawIndirectCount;
+
+    bool timestamps = queueFamily < vkb_device.queue_families.size() && vkb_device.queue_families[queueFamily].timestampValidBits > 0;
+    m_Vulkan.timestampPeriod = timestamps ? physical_device.properties.limits.timestampPeriod : 0.0f;
 }
 
 bool Vulkan::InitSwapchain()
 {
     auto rect = Graphics::NativeWindow::Get()->GetWindowSize();
 
+    if (m_SwapchainInfo.headless) {
+        return InitHeadlessImages(rect);
+    }
+
     vkb::SwapchainBuilder builder{ m_Vulkan.vkbDevice };
     builder.set_desired_format({ VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR })
         .set_old_swapchain(m_Swapchain.swapchain)
         .set_desired_extent((uint32_t)rect.Width, (uint32_t)rect.Height);
 
+    switch (m_SwapchainInfo.presentMode) {
+        case PresentMode::Immediate:
+            builder.set_desired_present_mode(VK_PRESENT_MODE_IMMEDIATE_KHR)
+                .add_fallback_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)
+                .add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+            break;
+
+        case PresentMode::Mailbox:
+            builder.set_desired_present_mode(VK_PRESENT_MODE_MAILBOX_KHR)
+                .add_fallback_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+            break;
+
+        default:
+            builder.set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+            break;
+    }
+
+    if (m_SwapchainInfo.imageCount > 0) {
+        builder.set_desired_min_image_count(m_SwapchainInfo.imageCount);
+    }
+
     auto resultbuild = builder.build();
     if (!resultbuild) {
         if (resultbuild.error() == vkb::SwapchainError::invalid_window_size) {
@@ -185,12 +273,87 @@ bool Vulkan::InitSwapchain()
 
     m_Swapchain.imageViews = vkbviews.value();
     m_Swapchain.images = vkimages.value();
+    m_Swapchain.imageHashes.assign(m_Swapchain.images.size(), 0);
 
     m_Vulkan.depthFormat = VK_FORMAT_D32_SFLOAT;
     m_Vulkan.swapchainFormat = m_Swapchain.swapchain.image_format;
 
-    auto swapchainExtent = m_Swapchain.swapchain.extent;
+    InitDepthImage(m_Swapchain.swapchain.extent);
+
+    m_SwapchainReady = true;
+    return true;
+}
+
+bool Vulkan::InitHeadlessImages(Rect rect)
+{
+    if (rect.Width <= 0 || rect.Height <= 0) {
+        return false;
+    }
+
+    m_Vulkan.depthFormat = VK_FORMAT_D32_SFLOAT;
+    m_Vulkan.swapchainFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+    VkExtent3D extent = { (uint32_t)rect.Width, (uint32_t)rect.Height, 1 };
+
+    // One image per frame in flight stands in for the swapchain, without acquire semaphores to order reuse
+    uint32_t imageCount = std::max(m_SwapchainInfo.framesInFlight, 1u);
+
+    m_Swapchain.images.resize(imageCount);
+    m_Swapchain.imageViews.resize(imageCount);
+    m_Swapchain.headlessMemory.resize(imageCount);
+
+    for (uint32_t i = 0; i < imageCount; i++) {
+        VkImageCreateInfo imageInfo = vkinit::image_create_info(m_Vulkan.swapchainFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, extent);
+
+        auto result = vkCreateImage(m_Vulkan.vkbDevice.device, &imageInfo, nullptr, &m_Swapchain.images[i]);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to create headless image");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(m_Vulkan.vkbDevice.device, m_Swapchain.images[i], &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = vkinit::find_memory_type(m_Vulkan.vkbDevice.physical_device, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        result = vkAllocateMemory(m_Vulkan.vkbDevice.device, &allocInfo, nullptr, &m_Swapchain.headlessMemory[i]);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to allocate headless image memory");
+        }
+
+        vkBindImageMemory(m_Vulkan.vkbDevice.device, m_Swapchain.images[i], m_Swapchain.headlessMemory[i], 0);
+
+        VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(m_Vulkan.swapchainFormat, m_Swapchain.images[i], VK_IMAGE_ASPECT_COLOR_BIT);
+        result = vkCreateImageView(m_Vulkan.vkbDevice.device, &viewInfo, nullptr, &m_Swapchain.imageViews[i]);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to create headless image view");
+        }
+    }
+
+    // Views go with the framebuffers
+    m_SwapchainDeletionQueue.push_function([=] {
+        for (size_t i = 0; i < m_Swapchain.images.size(); i++) {
+            vkDestroyImage(m_Vulkan.vkbDevice.device, m_Swapchain.images[i], nullptr);
+            vkFreeMemory(m_Vulkan.vkbDevice.device, m_Swapchain.headlessMemory[i], nullptr);
+        }
+
+        m_Swapchain.images.clear();
+        m_Swapchain.headlessMemory.clear();
+    });
 
+    m_Swapchain.imageHashes.assign(imageCount, 0);
+    m_Swapchain.headlessExtent = { extent.width, extent.height };
+
+    InitDepthImage(m_Swapchain.headlessExtent);
+
+    m_SwapchainReady = true;
+    return true;
+}
+
+void Vulkan::InitDepthImage(VkExtent2D swapchainExtent)
+{
     VkExtent3D depthImageExtent = {
         (uint32_t)swapchainExtent.width,
         (uint32_t)swapchainExtent.height,
@@ -236,9 +399,6 @@ bool Vulkan::InitSwapchain()
         m_Swapchain.depthImage = VK_NULL_HANDLE;
         m_Swapchain.depthImageMemory = VK_NULL_HANDLE;
     });
-
-    m_SwapchainReady = true;
-    return true;
 }
 
 void Vulkan::CreateRenderpass()
@@ -251,7 +411,7 @@ void Vulkan::CreateRenderpass()
     color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    color_attachment.finalLayout = m_SwapchainInfo.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference color_attachment_ref = {};
     color_attachment_ref.attachment = 0;
@@ -290,7 +450,8 @@ void Vulkan::CreateRenderpass()
     depth_dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     depth_dependency.dstSubpass = 0;
     depth_dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-    depth_dependency.srcAccessMask = 0;
+    // The depth image is shared by every frame in flight
+    depth_dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
     depth_dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
     depth_dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
@@ -313,6 +474,31 @@ void Vulkan::CreateRenderpass()
     }
 
     m_DeletionQueue.push_function([=]() { vkDestroyRenderPass(m_Vulkan.vkbDevice.device, m_Swapchain.renderpass, nullptr); });
+
+    // Same attachments as the main pass so the pipelines stay compatible, but the color is sampled afterwards
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkSubpassDependency sample_dependency = {};
+    sample_dependency.srcSubpass = 0;
+    sample_dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    sample_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    sample_dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    sample_dependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    sample_dependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    VkSubpassDependency offscreen_dependencies[3] = { dependency, depth_dependency, sample_dependency };
+    offscreen_dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    offscreen_dependencies[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    render_pass_info.dependencyCount = 3;
+    render_pass_info.pDependencies = &offscreen_dependencies[0];
+
+    result = vkCreateRenderPass(m_Vulkan.vkbDevice.device, &render_pass_info, nullptr, &m_Swapchain.offscreenRenderpass);
+    if (result != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create offscreen render pass");
+    }
+
+    m_DeletionQueue.push_function([=]() { vkDestroyRenderPass(m_Vulkan.vkbDevice.device, m_Swapchain.offscreenRenderpass, nullptr); });
 }
 
 void Vulkan::InitFramebuffers()
@@ -351,8 +537,8 @@ void Vulkan::InitCommands()
 {
     VkCommandPoolCreateInfo commandPoolInfo = vkinit::command_pool_create_info(m_Vulkan.graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 
-    m_Swapchain.frames.resize(MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    m_Swapchain.frames.resize(m_SwapchainInfo.framesInFlight);
+    for (size_t i = 0; i < m_Swapchain.frames.size(); i++) {
         auto result = vkCreateCommandPool(m_Vulkan.vkbDevice.device, &commandPoolInfo, nullptr, &m_Swapchain.frames[i].commandPool);
 
         if (result != VK_SUCCESS) {
@@ -367,6 +553,9 @@ void Vulkan::InitCommands()
             throw Exceptions::EstException("Failed to allocate command buffer");
         }
 
+        // Their pools went with the swapchain deletion queue
+        m_Swapchain.frames[i].recorders.clear();
+
         m_Swapchain.frames[i].isValid = true;
         m_SwapchainDeletionQueue.push_function([=]() {
             vkDestroyCommandPool(m_Vulkan.vkbDevice.device, m_Swapchain.frames[i].commandPool, nullptr);
@@ -396,20 +585,34 @@ void Vulkan::InitCommands()
     constexpr uint32_t MAX_VERTEX_BUFFER_SIZE = sizeof(Vertex) * MAX_VERTEX_OBJECTS;
     constexpr uint32_t MAX_INDEX_BUFFER_SIZE = sizeof(uint32_t) * MAX_VERTEX_OBJECTS;
 
-    memset(&m_Swapchain.vertexBuffer, 0, sizeof(m_Swapchain.vertexBuffer));
-    memset(&m_Swapchain.indexBuffer, 0, sizeof(m_Swapchain.indexBuffer));
+    for (size_t i = 0; i < m_Swapchain.frames.size(); i++) {
+        auto &frame = m_Swapchain.frames[i];
 
-    ResizeBuffer(MAX_VERTEX_BUFFER_SIZE, MAX_INDEX_BUFFER_SIZE);
+        memset(&frame.vertexBuffer, 0, sizeof(frame.vertexBuffer));
+        memset(&frame.indexBuffer, 0, sizeof(frame.indexBuffer));
 
-    m_Swapchain.maxVertexBufferSize = MAX_VERTEX_BUFFER_SIZE;
-    m_Swapchain.maxIndexBufferSize = MAX_INDEX_BUFFER_SIZE;
+        // Created by the first FlushQueue, the descriptor pool doesn't exist yet on Init
+        memset(&frame.indirectBuffer, 0, sizeof(frame.indirectBuffer));
+        memset(&frame.drawParamsBuffer, 0, sizeof(frame.drawParamsBuffer));
+        frame.maxDraws = 0;
+        frame.indirectCommands = nullptr;
+        frame.drawParams = nullptr;
+        frame.drawParamsSet = VK_NULL_HANDLE;
 
-    m_SwapchainDeletionQueue.push_function([=] {
-        vkDestroyBuffer(m_Vulkan.vkbDevice.device, m_Swapchain.vertexBuffer.buffer, nullptr);
-        vkFreeMemory(m_Vulkan.vkbDevice.device, m_Swapchain.vertexBuffer.memory, nullptr);
+        ResizeBuffer(frame, MAX_VERTEX_BUFFER_SIZE, MAX_INDEX_BUFFER_SIZE);
 
-        vkDestroyBuffer(m_Vulkan.vkbDevice.device, m_Swapchain.indexBuffer.buffer, nullptr);
-        vkFreeMemory(m_Vulkan.vkbDevice.device, m_Swapchain.indexBuffer.memory, nullptr); });
+        frame.maxVertexBufferSize = MAX_VERTEX_BUFFER_SIZE;
+        frame.maxIndexBufferSize = MAX_INDEX_BUFFER_SIZE;
+
+        m_SwapchainDeletionQueue.push_function([=] {
+            auto &frame = m_Swapchain.frames[i];
+
+            vkDestroyBuffer(m_Vulkan.vkbDevice.device, frame.vertexBuffer.buffer, nullptr);
+            vkFreeMemory(m_Vulkan.vkbDevice.device, frame.vertexBuffer.memory, nullptr);
+
+            vkDestroyBuffer(m_Vulkan.vkbDevice.device, frame.indexBuffer.buffer, nullptr);
+            vkFreeMemory(m_Vulkan.vkbDevice.device, frame.indexBuffer.memory, nullptr); });
+    }
 }
 
 void Vulkan::InitSyncStructures()
@@ -417,7 +620,7 @@ void Vulkan::InitSyncStructures()
     VkFenceCreateInfo     fenceCreateInfo = vkinit::fence_create_info(VK_FENCE_CREATE_SIGNALED_BIT);
     VkSemaphoreCreateInfo semaphoreCreateInfo = vkinit::semaphore_create_info();
 
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < m_Swapchain.frames.size(); i++) {
         auto result = vkCreateFence(m_Vulkan.vkbDevice.device, &fenceCreateInfo, nullptr, &m_Swapchain.frames[i].renderFence);
 
         if (result != VK_SUCCESS) {
@@ -452,19 +655,48 @@ void Vulkan::InitSyncStructures()
     m_SwapchainDeletionQueue.push_function([=]() { vkDestroyFence(m_Vulkan.vkbDevice.device, m_Swapchain.uploadContext.renderFence, nullptr); });
 }
 
+void Vulkan::InitQueries()
+{
+    for (size_t i = 0; i < m_Swapchain.frames.size(); i++) {
+        auto &frame = m_Swapchain.frames[i];
+
+        frame.queryPool = VK_NULL_HANDLE;
+        frame.queriesWritten = false;
+
+        if (m_Vulkan.timestampPeriod == 0.0f) {
+            continue;
+        }
+
+        VkQueryPoolCreateInfo queryPoolInfo = {};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = TimestampCount;
+
+        auto result = vkCreateQueryPool(m_Vulkan.vkbDevice.device, &queryPoolInfo, nullptr, &frame.queryPool);
+
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to create query pool");
+        }
+
+        m_SwapchainDeletionQueue.push_function([=]() {
+            vkDestroyQueryPool(m_Vulkan.vkbDevice.device, m_Swapchain.frames[i].queryPool, nullptr);
+            m_Swapchain.frames[i].queryPool = VK_NULL_HANDLE; });
+    }
+}
+
 void Vulkan::InitDescriptors()
 {
     std::vector<VkDescriptorPoolSize> sizes = {
         { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10 },
         { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10 },
         { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10 },
-        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10 }
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 }
     };
 
     VkDescriptorPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    poolInfo.maxSets = 10;
+    poolInfo.maxSets = 1000;
     poolInfo.poolSizeCount = (uint32_t)sizes.size();
     poolInfo.pPoolSizes = sizes.data();
 
@@ -490,7 +722,17 @@ void Vulkan::InitDescriptors()
         throw Exceptions::EstException("Failed to create descriptor set layout");
     }
 
+    binding[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    result = vkCreateDescriptorSetLayout(m_Vulkan.vkbDevice.device, &info, nullptr, &m_Vulkan.drawParamsLayout);
+
+    if (result != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create draw parameters descriptor set layout");
+    }
+
     m_DeletionQueue.push_function([=] {
+        vkDestroyDescriptorSetLayout(m_Vulkan.vkbDevice.device, m_Vulkan.drawParamsLayout, nullptr);
         vkDestroyDescriptorSetLayout(m_Vulkan.vkbDevice.device, m_Vulkan.descriptorSetLayout, nullptr);
         vkDestroyDescriptorPool(m_Vulkan.vkbDevice.device, m_Vulkan.descriptorPool, nullptr);
     });
@@ -498,11 +740,11 @@ void Vulkan::InitDescriptors()
 
 void Vulkan::InitShaders()
 {
-    const uint32_t *vertShaderCode = __glsl_position;
+    const uint32_t *vertShaderCode = __glsl_position_indirect;
     const uint32_t *solidFragShaderCode = __glsl_solid;
     const uint32_t *imageFragShaderCode = __glsl_image;
 
-    size_t vertShaderSize = sizeof(__glsl_position);
+    size_t vertShaderSize = sizeof(__glsl_position_indirect);
     size_t solidFragShaderSize = sizeof(__glsl_solid);
     size_t imageFragShaderSize = sizeof(__glsl_image);
 
@@ -552,6 +794,7 @@ void Vulkan::InitPipeline()
     // ADD, dstRGB = (srcRGB * srcA) + dstRGB, dstA = dstA
     // MOD, dstRGB = srcRGB * dstRGB, dstA = dstA
     // MUL dstRGB = (srcRGB * dstRGB) + (dstRGB * (1-srcA)), dstA = (srcA * dstA) + (dstA * (1-srcA))
+    // PREMULTIPLIED, dstRGB = srcRGB + (dstRGB * (1-srcA)), dstA = srcA + (dstA * (1-srcA))
 
     TextureBlendInfo blendNone = {
         true,
@@ -568,7 +811,7 @@ void Vulkan::InitPipeline()
         BlendFactor::BLEND_FACTOR_SRC_ALPHA,
         BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         BlendOp::BLEND_OP_ADD,
-        BlendFactor::BLEND_FACTOR_SRC_ALPHA,
+        BlendFactor::BLEND_FACTOR_ONE,
         BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         BlendOp::BLEND_OP_ADD
     };
@@ -603,11 +846,22 @@ void Vulkan::InitPipeline()
         BlendOp::BLEND_OP_ADD
     };
 
+    TextureBlendInfo blendPremultiplied = {
+        true,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD,
+        BlendFactor::BLEND_FACTOR_ONE,
+        BlendFactor::BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        BlendOp::BLEND_OP_ADD
+    };
+
     CreateBlendState(blendNone);
     CreateBlendState(blendBlend);
     CreateBlendState(blendAdd);
     CreateBlendState(blendMod);
     CreateBlendState(blendMul);
+    CreateBlendState(blendPremultiplied);
 }
 
 void Vulkan::ImmediateSubmit(std::function<void(VkCommandBuffer)> &&function)
@@ -643,12 +897,12 @@ void Vulkan::ImmediateSubmit(std::function<void(VkCommandBuffer)> &&function)
 
 VulkanFrame &Vulkan::GetCurrentFrame()
 {
-    return m_Swapchain.frames[m_CurrentFrame % MAX_FRAMES_IN_FLIGHT];
+    return m_Swapchain.frames[m_CurrentFrame % m_Swapchain.frames.size()];
 }
 
 VulkanFrame &Vulkan::GetLastFrame()
 {
-    return m_Swapchain.frames[(m_CurrentFrame - 1) % MAX_FRAMES_IN_FLIGHT];
+    return m_Swapchain.frames[(m_CurrentFrame - 1) % m_Swapchain.frames.size()];
 }
 
 bool Vulkan::BeginFrame()
@@ -657,26 +911,32 @@ bool Vulkan::BeginFrame()
         return false;
     }
 
-    auto result = vkDeviceWaitIdle(m_Vulkan.vkbDevice.device);
-    if (result != VK_SUCCESS) {
-        throw Exceptions::EstException("Failed to wait for device idle");
-    }
-
+    // Only this frame's previous use has to finish, the others stay in flight
     auto &frame = GetCurrentFrame();
 
-    result = vkWaitForFences(m_Vulkan.vkbDevice.device, 1, &frame.renderFence, true, 9999999999);
+    auto result = vkWaitForFences(m_Vulkan.vkbDevice.device, 1, &frame.renderFence, true, 9999999999);
     if (result == VK_TIMEOUT) {
         return false;
     } else if (result != VK_SUCCESS) {
         throw Exceptions::EstException("Failed to wait for fence");
     }
 
-    result = vkResetFences(m_Vulkan.vkbDevice.device, 1, &frame.renderFence);
-    if (result != VK_SUCCESS) {
-        throw Exceptions::EstException("Failed to reset fence");
+    // The fence signaled, so its timestamps are available and reading them doesn't wait
+    ReadTimestamps(frame);
+
+    uint64_t framesInFlight = m_Swapchain.frames.size();
+    if (m_CurrentFrame >= framesInFlight) {
+        m_PerFrameDeletionQueue.flush(m_CurrentFrame - framesInFlight);
+    }
+
+    if (m_SwapchainInfo.headless) {
+        // The frame's fence already covers its image
+        m_Swapchain.swapchainIndex = (uint32_t)(m_CurrentFrame % m_Swapchain.images.size());
+        result = VK_SUCCESS;
+    } else {
+        result = vkAcquireNextImageKHR(m_Vulkan.vkbDevice.device, m_Swapchain.swapchain, UINT64_MAX, frame.presentSemaphore, VK_NULL_HANDLE, &m_Swapchain.swapchainIndex);
     }
 
-    result = vkAcquireNextImageKHR(m_Vulkan.vkbDevice.device, m_Swapchain.swapchain, UINT64_MAX, frame.presentSemaphore, VK_NULL_HANDLE, &m_Swapchain.swapchainIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         m_SwapchainReady = false;
         return false;
@@ -696,7 +956,15 @@ bool Vulkan::BeginFrame()
         throw Exceptions::EstException("Failed to reset command pool");
     }
 
-    m_PerFrameDeletionQueue.flush();
+    for (auto &recorder : frame.recorders) {
+        result = vkResetCommandPool(m_Vulkan.vkbDevice.device, recorder.commandPool, 0);
+
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to reset recorder command pool");
+        }
+
+        recorder.used = 0;
+    }
 
     if (!frame.isValid) {
         return false;
@@ -710,25 +978,11 @@ bool Vulkan::BeginFrame()
         throw Exceptions::EstException("Failed to begin command buffer");
     }
 
-    VkClearValue clearValue;
-    clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-
-    auto       rect = Graphics::NativeWindow::Get()->GetWindowSize();
-    VkExtent2D _windowExtent = {
-        (uint32_t)rect.Width,
-        (uint32_t)rect.Height
-    };
-
-    VkClearValue depthClear;
-    depthClear.depthStencil.depth = 1.f;
-
-    VkRenderPassBeginInfo rpInfo = vkinit::renderpass_begin_info(m_Swapchain.renderpass, _windowExtent, m_Swapchain.framebuffers[m_Swapchain.swapchainIndex]);
-
-    VkClearValue clearValues[] = { clearValue, depthClear };
-    rpInfo.pClearValues = &clearValues[0];
-    rpInfo.clearValueCount = 2;
+    if (frame.queryPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(frame.commandBuffer, frame.queryPool, 0, TimestampCount);
+    }
 
-    vkCmdBeginRenderPass(frame.commandBuffer, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // Render passes are begun in FlushQueue, offscreen targets must be recorded before the main pass
     m_FrameBegin = true;
 
     return true;
@@ -742,10 +996,35 @@ void Vulkan::EndFrame()
 
     auto &frame = GetCurrentFrame();
 
-    FlushQueue();
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frame.commandBuffer);
+    // Re-presenting leaves the command buffer empty, it only carries the semaphores
+    if (!m_Represent) {
+        WriteTimestamp(frame.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, TimestampBegin);
+
+        FlushQueue();
 
-    vkCmdEndRenderPass(frame.commandBuffer);
+        ImDrawData *drawData = m_ImGuiDrawData ? m_ImGuiDrawData : ImGui::GetDrawData();
+        if (m_MainPassSecondary) {
+            auto imgui = GetSecondaryBuffer(frame, 0);
+            BeginSecondaryBuffer(imgui, m_MainPassInfo);
+
+            WriteTimestamp(imgui, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, TimestampImGui);
+            ImGui_ImplVulkan_RenderDrawData(drawData, imgui);
+
+            if (vkEndCommandBuffer(imgui) != VK_SUCCESS) {
+                throw Exceptions::EstException("Failed to end secondary command buffer");
+            }
+
+            vkCmdExecuteCommands(frame.commandBuffer, 1, &imgui);
+        } else {
+            WriteTimestamp(frame.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, TimestampImGui);
+            ImGui_ImplVulkan_RenderDrawData(drawData, frame.commandBuffer);
+        }
+
+        vkCmdEndRenderPass(frame.commandBuffer);
+
+        WriteTimestamp(frame.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, TimestampEnd);
+        frame.queriesWritten = frame.queryPool != VK_NULL_HANDLE;
+    }
 
     auto result = vkEndCommandBuffer(frame.commandBuffer);
 
@@ -762,12 +1041,23 @@ void Vulkan::EndFrame()
     submit.signalSemaphoreCount = 1;
     submit.pSignalSemaphores = &frame.renderSemaphore;
 
+    // Nothing acquires or presents, the semaphores would never be waited on
+    if (m_SwapchainInfo.headless) {
+        submit.waitSemaphoreCount = 0;
+        submit.signalSemaphoreCount = 0;
+    }
+
     result = vkQueueSubmit(m_Vulkan.graphicsQueue, 1, &submit, frame.renderFence);
 
     if (result != VK_SUCCESS) {
         throw Exceptions::EstException("Failed to submit queue");
     }
 
+    if (m_CaptureRequested) {
+        m_CaptureRequested = false;
+        CaptureImage(m_Swapchain.swapchainIndex);
+    }
+
     VkPresentInfoKHR presentInfo = vkinit::present_info();
     presentInfo.pSwapchains = &m_Swapchain.swapchain.swapchain;
     presentInfo.swapchainCount = 1;
@@ -775,7 +1065,14 @@ void Vulkan::EndFrame()
     presentInfo.waitSemaphoreCount = 1;
     presentInfo.pImageIndices = &m_Swapchain.swapchainIndex;
 
-    result = vkQueuePresentKHR(m_Vulkan.graphicsQueue, &presentInfo);
+    if (!m_Represent && m_Swapchain.swapchainIndex < m_Swapchain.imageHashes.size()) {
+        m_Swapchain.imageHashes[m_Swapchain.swapchainIndex] = m_FrameHash;
+    }
+
+    m_Represent = false;
+    m_FrameHash = 0;
+
+    result = m_SwapchainInfo.headless ? VK_SUCCESS : vkQueuePresentKHR(m_Vulkan.graphicsQueue, &presentInfo);
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
         m_SwapchainReady = false;
     } else {
@@ -788,175 +1085,622 @@ void Vulkan::EndFrame()
     m_FrameBegin = false;
 }
 
-bool Vulkan::NeedReinit()
+void Vulkan::WaitForPresent()
 {
-    return !m_SwapchainReady;
-}
+    if (!m_SwapchainReady || m_FrameBegin || m_CurrentFrame == 0 || m_Swapchain.frames.empty()) {
+        return;
+    }
 
-void Vulkan::Push(SubmitInfo &info)
-{
-    submitInfos.push_back(info);
+    auto &frame = GetLastFrame();
+
+    auto result = vkWaitForFences(m_Vulkan.vkbDevice.device, 1, &frame.renderFence, true, 9999999999);
+    if (result != VK_SUCCESS && result != VK_TIMEOUT) {
+        throw Exceptions::EstException("Failed to wait for fence");
+    }
 }
 
-void Vulkan::FlushQueue()
+void Vulkan::ReadTimestamps(VulkanFrame &frame)
 {
-    if (submitInfos.size() <= 0) {
+    if (!frame.queriesWritten) {
         return;
     }
 
-    if (!m_SwapchainReady) {
-        submitInfos.clear();
-        return;
-    }
+    frame.queriesWritten = false;
 
-    auto &frame = GetCurrentFrame();
-    if (!frame.isValid) {
-        submitInfos.clear();
+    uint64_t timestamps[TimestampCount];
+    auto     result = vkGetQueryPoolResults(m_Vulkan.vkbDevice.device, frame.queryPool, 0, TimestampCount, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result != VK_SUCCESS) {
         return;
     }
 
-    std::sort(submitInfos.begin(), submitInfos.end(), [](SubmitInfo &a, SubmitInfo &b) {
-        return a.zIndex < b.zIndex;
-    });
+    auto milliseconds = [&](GpuTimestamp from, GpuTimestamp to) {
+        return (double)(timestamps[to] - timestamps[from]) * m_Vulkan.timestampPeriod / 1000000.0;
+    };
 
-    VkDeviceSize vertex_size = 0;
-    VkDeviceSize indices_size = 0;
-    for (auto &info : submitInfos) {
-        vertex_size += info.vertices.size() * sizeof(info.vertices[0]);
-        indices_size += info.indices.size() * sizeof(info.indices[0]);
-    }
+    m_GpuTimings.valid = true;
+    m_GpuTimings.targets = milliseconds(TimestampBegin, TimestampMainPass);
+    m_GpuTimings.main = milliseconds(TimestampMainPass, TimestampImGui);
+    m_GpuTimings.imgui = milliseconds(TimestampImGui, TimestampEnd);
+    m_GpuTimings.total = milliseconds(TimestampBegin, TimestampEnd);
+}
 
-    if (vertex_size >= m_Swapchain.maxVertexBufferSize || indices_size >= m_Swapchain.maxIndexBufferSize) {
-        ResizeBuffer(vertex_size, indices_size);
+void Vulkan::WriteTimestamp(VkCommandBuffer cmd, VkPipelineStageFlagBits stage, uint32_t query)
+{
+    auto &frame = GetCurrentFrame();
+    if (frame.queryPool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(cmd, stage, frame.queryPool, query);
     }
+}
 
-    void *vertexPtr;
-    void *indicePtr;
+GpuTimings Vulkan::GetGpuTimings()
+{
+    return m_GpuTimings;
+}
 
-    auto result = vkMapMemory(m_Vulkan.vkbDevice.device, m_Swapchain.vertexBuffer.memory, 0, vertex_size, 0, &vertexPtr);
-    if (result != VK_SUCCESS) {
-        throw Exceptions::EstException("Failed to map GPU's vertex buffer");
-    }
+void Vulkan::SetImGuiDrawData(ImDrawData *data)
+{
+    m_ImGuiDrawData = data;
+}
 
-    result = vkMapMemory(m_Vulkan.vkbDevice.device, m_Swapchain.indexBuffer.memory, 0, indices_size, 0, &indicePtr);
-    if (result != VK_SUCCESS) {
-        throw Exceptions::EstException("Failed to map GPU's index buffer");
+void Vulkan::RequestCapture()
+{
+    if (!m_SwapchainInfo.headless) {
+        throw Exceptions::EstException("Frame capture needs headless mode");
     }
 
-    VkDeviceSize offset = 0;
-    for (auto &info : submitInfos) {
-        if (offset >= m_Swapchain.maxVertexBufferSize) {
-            continue;
-        }
+    m_CaptureRequested = true;
+}
 
-        memcpy((char *)vertexPtr + offset, info.vertices.data(), info.vertices.size() * sizeof(info.vertices[0]));
-        offset += info.vertices.size() * sizeof(info.vertices[0]);
+bool Vulkan::ReadCapture(std::vector<uint8_t> &pixels, int &width, int &height)
+{
+    if (m_Capture.empty()) {
+        return false;
     }
 
-    offset = 0;
-    for (auto &info : submitInfos) {
-        memcpy((char *)indicePtr + offset, info.indices.data(), info.indices.size() * sizeof(info.indices[0]));
-        offset += info.indices.size() * sizeof(info.indices[0]);
-    }
+    pixels = std::move(m_Capture);
+    width = (int)m_Swapchain.headlessExtent.width;
+    height = (int)m_Swapchain.headlessExtent.height;
 
-    vkUnmapMemory(m_Vulkan.vkbDevice.device, m_Swapchain.vertexBuffer.memory);
-    vkUnmapMemory(m_Vulkan.vkbDevice.device, m_Swapchain.indexBuffer.memory);
-    auto rect = Graphics::NativeWindow::Get()->GetWindowSize();
+    m_Capture.clear();
+    return true;
+}
 
-    VkViewport viewport = {};
-    viewport.x = 0;
-    viewport.y = 0;
-    viewport.width = (float)(rect.Width <= 0 ? 1 : rect.Width);
-    viewport.height = (float)(rect.Height <= 0 ? 1 : rect.Height);
-    viewport.maxDepth = 1.0f;
+void Vulkan::CaptureImage(uint32_t index)
+{
+    auto device = m_Vulkan.vkbDevice.device;
+    auto extent = m_Swapchain.headlessExtent;
 
-    vkCmdSetViewport(frame.commandBuffer, 0, 1, &viewport);
+    auto result = vkWaitForFences(device, 1, &GetCurrentFrame().renderFence, true, UINT64_MAX);
+    if (result != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to wait for fence");
+    }
 
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(frame.commandBuffer, 0, 1, &m_Swapchain.vertexBuffer.buffer, offsets);
-    vkCmdBindIndexBuffer(frame.commandBuffer, m_Swapchain.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+    VkDeviceSize size = (VkDeviceSize)extent.width * extent.height * 4;
 
-    int currentVertIndex = 0; // vertex
-    int currentIndiIndex = 0; // indicies
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    PushConstant pc = {};
+    VulkanBuffer staging = {};
+    result = vkCreateBuffer(device, &bufferInfo, nullptr, &staging.buffer);
+    if (result != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create capture buffer");
+    }
 
-    pc.scale = glm::vec2(2.0f / rect.Width, 2.0f / rect.Height);
-    pc.translate = glm::vec2(-1.0f, -1.0f);
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, staging.buffer, &memRequirements);
 
-    for (auto &info : submitInfos) {
-        auto &blendinfo = m_BlendStates[info.alphablend];
-        auto  pipeline = m_Swapchain.pipelineLayout;
-        auto  graphics = blendinfo.pipelines[info.fragmentType];
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = vkinit::find_memory_type(
+        m_Vulkan.vkbDevice.physical_device,
+        memRequirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-        pc.ui_size = info.uiSize;
-        pc.ui_radius = info.uiRadius;
+    result = vkAllocateMemory(device, &allocInfo, nullptr, &staging.memory);
+    if (result != VK_SUCCESS) {
+        vkDestroyBuffer(device, staging.buffer, nullptr);
+        throw Exceptions::EstException("Failed to allocate capture buffer memory");
+    }
 
-        vkCmdPushConstants(frame.commandBuffer, pipeline, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstant), &pc);
+    vkBindBufferMemory(device, staging.buffer, staging.memory, 0);
 
-        VkDescriptorSet image = (VkDescriptorSet)(info.image != 0 ? (void *)info.image : VK_NULL_HANDLE);
-        uint32_t        imageCount = 1;
-        if (image == NULL) {
-            imageCount = 0;
-        }
+    // The main pass leaves headless images in TRANSFER_SRC_OPTIMAL
+    ImmediateSubmit([=](VkCommandBuffer cmd) {
+        VkBufferImageCopy region = {};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = { extent.width, extent.height, 1 };
 
-        vkCmdBindDescriptorSets(frame.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline, 0, 1, &image, 0, nullptr);
-        vkCmdBindPipeline(frame.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics);
+        vkCmdCopyImageToBuffer(cmd, m_Swapchain.images[index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging.buffer, 1, &region);
+    });
 
-        VkRect2D clip = {};
-        clip.offset = {
-            info.clipRect.X, info.clipRect.Y
-        };
-        clip.extent = {
-            (uint32_t)info.clipRect.Width, (uint32_t)info.clipRect.Height
-        };
+    void *data;
+    result = vkMapMemory(device, staging.memory, 0, size, 0, &data);
+    if (result == VK_SUCCESS) {
+        m_Capture.assign((uint8_t *)data, (uint8_t *)data + size);
+        vkUnmapMemory(device, staging.memory);
+    }
 
-        vkCmdSetScissor(frame.commandBuffer, 0, 1, &clip);
+    vkDestroyBuffer(device, staging.buffer, nullptr);
+    vkFreeMemory(device, staging.memory, nullptr);
 
-        vkCmdDrawIndexed(frame.commandBuffer, (uint32_t)info.vertices.size(), 1, currentIndiIndex, currentVertIndex, 0);
-        currentVertIndex += (int)info.vertices.size();
-        currentIndiIndex += (int)info.indices.size();
+    if (result != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to map capture buffer");
     }
-
-    submitInfos.clear();
 }
 
-void Vulkan::ResizeBuffer(VkDeviceSize vertices, VkDeviceSize indicies)
+bool Vulkan::Represent(uint64_t hash)
 {
-    auto result = VK_SUCCESS;
-
-    if (vertices > m_Swapchain.maxVertexBufferSize) {
-        m_Swapchain.maxVertexBufferSize = (uint32_t)vertices;
-    }
-
-    if (indicies > m_Swapchain.maxIndexBufferSize) {
-        m_Swapchain.maxIndexBufferSize = (uint32_t)indicies;
+    auto index = m_Swapchain.swapchainIndex;
+    if (hash == 0 || index >= m_Swapchain.imageHashes.size() || m_Swapchain.imageHashes[index] != hash) {
+        m_FrameHash = hash;
+        return false;
     }
 
-    if (m_Swapchain.vertexBuffer.buffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_Vulkan.vkbDevice.device, m_Swapchain.vertexBuffer.buffer, nullptr);
-        vkFreeMemory(m_Vulkan.vkbDevice.device, m_Swapchain.vertexBuffer.memory, nullptr);
-    }
+    m_Represent = true;
+    EndFrame();
 
-    if (m_Swapchain.indexBuffer.buffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_Vulkan.vkbDevice.device, m_Swapchain.indexBuffer.buffer, nullptr);
-        vkFreeMemory(m_Vulkan.vkbDevice.device, m_Swapchain.indexBuffer.memory, nullptr);
-    }
+    return true;
+}
 
-    {
-        VkBufferCreateInfo bufferInfo = {};
+bool Vulkan::NeedReinit()
+{
+    return !m_SwapchainReady;
+}
+
+void Vulkan::Push(SubmitInfo &info)
+{
+    if (m_CurrentTarget != kBackbuffer) {
+        m_RenderTargets[m_CurrentTarget].submitInfos.push_back(info);
+        return;
+    }
+
+    submitInfos.push_back(info);
+}
+
+void Vulkan::FlushQueue()
+{
+    auto &frame = GetCurrentFrame();
+    auto  rect = Graphics::NativeWindow::Get()->GetWindowSize();
+
+    // A layer nested in another layer is activated after its parent, so walk backwards
+    std::vector<VulkanRenderTarget *> targets;
+    for (auto it = m_TargetOrder.rbegin(); it != m_TargetOrder.rend(); it++) {
+        auto target = m_RenderTargets.find(*it);
+        if (target != m_RenderTargets.end() && target->second.submitInfos.size()) {
+            targets.push_back(&target->second);
+        }
+    }
+
+    m_TargetOrder.clear();
+
+    std::vector<std::vector<SubmitInfo> *> queues;
+    for (auto target : targets) {
+        queues.push_back(&target->submitInfos);
+    }
+
+    queues.push_back(&submitInfos);
+
+    bool         compact = m_VertexFormat == VertexFormat::Compact;
+    VkDeviceSize vertex_stride = compact ? sizeof(CompactVertex) : sizeof(Vertex);
+    VkDeviceSize vertex_size = 0;
+    VkDeviceSize indices_size = 0;
+    size_t       draws = 0;
+    for (auto queue : queues) {
+        draws += queue->size();
+
+        std::stable_sort(queue->begin(), queue->end(), [](const SubmitInfo &a, const SubmitInfo &b) {
+            return a.zIndex < b.zIndex;
+        });
+
+        for (auto &info : *queue) {
+            vertex_size += info.vertices.size() * vertex_stride;
+            indices_size += info.indices.size() * sizeof(info.indices[0]);
+        }
+    }
+
+    if (vertex_size >= frame.maxVertexBufferSize || indices_size >= frame.maxIndexBufferSize) {
+        ResizeBuffer(frame, vertex_size, indices_size);
+    }
+
+    if (draws > frame.maxDraws || frame.drawParamsSet == VK_NULL_HANDLE) {
+        ResizeDrawBuffers(frame, (uint32_t)draws);
+    }
+
+    if (vertex_size > 0 && indices_size > 0) {
+        void *vertexPtr;
+        void *indicePtr;
+
+        auto result = vkMapMemory(m_Vulkan.vkbDevice.device, frame.vertexBuffer.memory, 0, vertex_size, 0, &vertexPtr);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to map GPU's vertex buffer");
+        }
+
+        result = vkMapMemory(m_Vulkan.vkbDevice.device, frame.indexBuffer.memory, 0, indices_size, 0, &indicePtr);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to map GPU's index buffer");
+        }
+
+        VkDeviceSize vertexOffset = 0;
+        VkDeviceSize indexOffset = 0;
+        for (auto queue : queues) {
+            for (auto &info : *queue) {
+                if (compact) {
+                    auto dst = (CompactVertex *)((char *)vertexPtr + vertexOffset);
+                    for (size_t i = 0; i < info.vertices.size(); i++) {
+                        dst[i] = ToCompactVertex(info.vertices[i]);
+                    }
+                } else {
+                    memcpy((char *)vertexPtr + vertexOffset, info.vertices.data(), info.vertices.size() * sizeof(info.vertices[0]));
+                }
+
+                vertexOffset += info.vertices.size() * vertex_stride;
+
+                memcpy((char *)indicePtr + indexOffset, info.indices.data(), info.indices.size() * sizeof(info.indices[0]));
+                indexOffset += info.indices.size() * sizeof(info.indices[0]);
+            }
+        }
+
+        vkUnmapMemory(m_Vulkan.vkbDevice.device, frame.vertexBuffer.memory);
+        vkUnmapMemory(m_Vulkan.vkbDevice.device, frame.indexBuffer.memory);
+    }
+
+    uint32_t vertexBase = 0;
+    uint32_t indexBase = 0;
+    uint32_t drawBase = 0;
+
+    VkClearValue depthClear = {};
+    depthClear.depthStencil.depth = 1.f;
+
+    for (auto target : targets) {
+        VkClearValue clearValue;
+        clearValue.color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+
+        VkExtent2D extent = {
+            (uint32_t)target->rect.Width,
+            (uint32_t)target->rect.Height
+        };
+
+        VkRenderPassBeginInfo rpInfo = vkinit::renderpass_begin_info(m_Swapchain.offscreenRenderpass, extent, target->framebuffer);
+
+        VkClearValue clearValues[] = { clearValue, depthClear };
+        rpInfo.pClearValues = &clearValues[0];
+        rpInfo.clearValueCount = 2;
+
+        RecordQueue(frame.commandBuffer, rpInfo, target->submitInfos, target->rect, vertexBase, indexBase, drawBase);
+        vkCmdEndRenderPass(frame.commandBuffer);
+
+        target->submitInfos.clear();
+    }
+
+    VkClearValue clearValue;
+    clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+
+    VkExtent2D _windowExtent = {
+        (uint32_t)rect.Width,
+        (uint32_t)rect.Height
+    };
+
+    VkRenderPassBeginInfo rpInfo = vkinit::renderpass_begin_info(m_Swapchain.renderpass, _windowExtent, m_Swapchain.framebuffers[m_Swapchain.swapchainIndex]);
+
+    VkClearValue clearValues[] = { clearValue, depthClear };
+    rpInfo.pClearValues = &clearValues[0];
+    rpInfo.clearValueCount = 2;
+
+    WriteTimestamp(frame.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, TimestampMainPass);
+
+    Rect windowRect = { 0, 0, rect.Width, rect.Height };
+    m_MainPassInfo = rpInfo;
+    m_MainPassInfo.pClearValues = nullptr;
+    m_MainPassSecondary = RecordQueue(frame.commandBuffer, rpInfo, submitInfos, windowRect, vertexBase, indexBase, drawBase);
+
+    submitInfos.clear();
+}
+
+bool Vulkan::RecordQueue(VkCommandBuffer cmd, const VkRenderPassBeginInfo &rpInfo, std::vector<SubmitInfo> &queue, Rect rect, uint32_t &vertexBase, uint32_t &indexBase, uint32_t &drawBase)
+{
+    // Below this many draws per thread the hand-off costs more than it saves
+    constexpr size_t kMinDrawsPerChunk = 128;
+
+    struct Draw
+    {
+        VkPipeline      pipeline;
+        VkDescriptorSet image;
+        VkRect2D        clip;
+    };
+
+    // Geometry was uploaded in queue order, remember where each submission starts
+    std::vector<std::pair<uint32_t, uint32_t>> bases(queue.size());
+    for (size_t i = 0; i < queue.size(); i++) {
+        bases[i] = { vertexBase, indexBase };
+        vertexBase += (uint32_t)queue[i].vertices.size();
+        indexBase += (uint32_t)queue[i].indices.size();
+    }
+
+    auto &frame = GetCurrentFrame();
+    auto  commands = (VkDrawIndexedIndirectCommand *)frame.indirectCommands + drawBase;
+    auto  params = (DrawParams *)frame.drawParams + drawBase;
+
+    // Compact positions arrive in the shader scaled by kCompactPositionUnit
+    float unit = m_VertexFormat == VertexFormat::Compact ? kCompactPositionUnit : 1.0f;
+
+    // Commands and parameters are written in draw order, so equal state between neighbours becomes one indirect call
+    std::vector<Draw> draws;
+    draws.reserve(queue.size());
+
+    auto addDraw = [&](size_t i, bool opaque) {
+        auto &info = queue[i];
+
+        int x0 = std::max(info.clipRect.X - rect.X, 0);
+        int y0 = std::max(info.clipRect.Y - rect.Y, 0);
+        int x1 = std::min(info.clipRect.X + info.clipRect.Width - rect.X, rect.Width);
+        int y1 = std::min(info.clipRect.Y + info.clipRect.Height - rect.Y, rect.Height);
+
+        if (x1 <= x0 || y1 <= y0) {
+            return;
+        }
+
+        // Opaque submissions all go through NONE, the only blend state whose pipelines write depth
+        auto &blendinfo = m_BlendStates[opaque ? DefaultBlend::NONE : info.alphablend];
+
+        Draw draw = {};
+        draw.pipeline = blendinfo.pipelines[{ info.fragmentType, GetShaderVariant(info) }];
+        draw.image = (VkDescriptorSet)(info.image != 0 ? (void *)info.image : VK_NULL_HANDLE);
+        draw.clip.offset = { x0, y0 };
+        draw.clip.extent = { (uint32_t)(x1 - x0), (uint32_t)(y1 - y0) };
+
+        auto slot = draws.size();
+
+        auto &command = commands[slot];
+        command.indexCount = (uint32_t)info.indices.size();
+        command.instanceCount = 1;
+        command.firstIndex = bases[i].second;
+        command.vertexOffset = (int32_t)bases[i].first;
+        command.firstInstance = drawBase + (uint32_t)slot;
+
+        auto &param = params[slot];
+        param.ui_radius = info.uiRadius;
+        param.ui_size = info.uiSize;
+        param.pivot = info.pivot * unit;
+        param.transform = info.transform;
+        param.offset = info.offset * unit;
+        param.depth = GetSubmissionDepth(i, queue.size());
+
+        draws.push_back(draw);
+    };
+
+    std::vector<bool> opaque(queue.size());
+    for (size_t i = 0; i < queue.size(); i++) {
+        opaque[i] = IsOpaque(queue[i]);
+    }
+
+    // Front-to-back so covered pixels fail the depth test before shading
+    for (size_t i = queue.size(); i-- > 0;) {
+        if (opaque[i]) {
+            addDraw(i, true);
+        }
+    }
+
+    for (size_t i = 0; i < queue.size(); i++) {
+        if (!opaque[i]) {
+            addDraw(i, false);
+        }
+    }
+
+    VkViewport viewport = {};
+    viewport.x = 0;
+    viewport.y = 0;
+    viewport.width = (float)(rect.Width <= 0 ? 1 : rect.Width);
+    viewport.height = (float)(rect.Height <= 0 ? 1 : rect.Height);
+    viewport.maxDepth = 1.0f;
+
+    PushConstant pc = {};
+
+    // Window-space positions, shifted so the target's origin lands on the top-left corner
+    pc.scale = glm::vec2(2.0f / viewport.width, 2.0f / viewport.height);
+    pc.translate = glm::vec2(-1.0f - rect.X * pc.scale.x, -1.0f - rect.Y * pc.scale.y);
+    pc.scale /= unit;
+
+    auto     layout = m_Swapchain.pipelineLayout;
+    uint32_t base = drawBase;
+    drawBase += (uint32_t)draws.size();
+
+    auto drawRun = [&](VkCommandBuffer cmd, size_t begin, size_t end) {
+        if (!m_Vulkan.indirectDraw) {
+            for (size_t d = begin; d < end; d++) {
+                auto &command = commands[d];
+                vkCmdDrawIndexed(cmd, command.indexCount, 1, command.firstIndex, command.vertexOffset, command.firstInstance);
+            }
+
+            return;
+        }
+
+        while (begin < end) {
+            auto count = (uint32_t)std::min<size_t>(end - begin, m_Vulkan.maxDrawIndirectCount);
+            auto offset = (VkDeviceSize)(base + begin) * sizeof(VkDrawIndexedIndirectCommand);
+
+            vkCmdDrawIndexedIndirect(cmd, frame.indirectBuffer.buffer, offset, count, sizeof(VkDrawIndexedIndirectCommand));
+            begin += count;
+        }
+    };
+
+    // Every chunk sets all the state it uses, so splitting records the same commands
+    auto record = [&](VkCommandBuffer cmd, size_t begin, size_t end) {
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(cmd, 0, 1, &frame.vertexBuffer.buffer, offsets);
+        vkCmdBindIndexBuffer(cmd, frame.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+
+        vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstant), &pc);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &frame.drawParamsSet, 0, nullptr);
+
+        size_t run = begin;
+        for (size_t d = begin; d < end; d++) {
+            auto &draw = draws[d];
+
+            if (d != run) {
+                auto &first = draws[run];
+                if (first.pipeline == draw.pipeline && first.image == draw.image && memcmp(&first.clip, &draw.clip, sizeof(VkRect2D)) == 0) {
+                    continue;
+                }
+
+                drawRun(cmd, run, d);
+                run = d;
+            }
+
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &draw.image, 0, nullptr);
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+            vkCmdSetScissor(cmd, 0, 1, &draw.clip);
+        }
+
+        if (run < end) {
+            drawRun(cmd, run, end);
+        }
+    };
+
+    uint32_t chunks = (uint32_t)std::min<size_t>(m_RecordPool.GetThreads(), draws.size() / kMinDrawsPerChunk);
+    if (chunks <= 1) {
+        vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        if (draws.size()) {
+            record(cmd, 0, draws.size());
+        }
+
+        return false;
+    }
+
+    vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+    // Allocated up front, a recorder's pool is only touched by the thread recording chunk of the same index
+    std::vector<VkCommandBuffer> buffers(chunks);
+    for (uint32_t c = 0; c < chunks; c++) {
+        buffers[c] = GetSecondaryBuffer(frame, c);
+    }
+
+    m_RecordPool.Run(chunks, [&](uint32_t c) {
+        size_t begin = draws.size() * c / chunks;
+        size_t end = draws.size() * (c + 1) / chunks;
+
+        BeginSecondaryBuffer(buffers[c], rpInfo);
+        record(buffers[c], begin, end);
+
+        if (vkEndCommandBuffer(buffers[c]) != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to end secondary command buffer");
+        }
+    });
+
+    vkCmdExecuteCommands(cmd, chunks, buffers.data());
+    return true;
+}
+
+VkCommandBuffer Vulkan::GetSecondaryBuffer(VulkanFrame &frame, uint32_t recorder)
+{
+    while (frame.recorders.size() <= recorder) {
+        VulkanRecorder item = {};
+
+        VkCommandPoolCreateInfo commandPoolInfo = vkinit::command_pool_create_info(m_Vulkan.graphicsQueueFamily);
+        auto                    result = vkCreateCommandPool(m_Vulkan.vkbDevice.device, &commandPoolInfo, nullptr, &item.commandPool);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to create recorder command pool");
+        }
+
+        auto pool = item.commandPool;
+        m_SwapchainDeletionQueue.push_function([=]() {
+            vkDestroyCommandPool(m_Vulkan.vkbDevice.device, pool, nullptr);
+        });
+
+        frame.recorders.push_back(std::move(item));
+    }
+
+    auto &item = frame.recorders[recorder];
+    if (item.used == item.commandBuffers.size()) {
+        VkCommandBuffer             buffer;
+        VkCommandBufferAllocateInfo cmdAllocInfo = vkinit::command_buffer_allocate_info(item.commandPool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+        auto result = vkAllocateCommandBuffers(m_Vulkan.vkbDevice.device, &cmdAllocInfo, &buffer);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to allocate secondary command buffer");
+        }
+
+        item.commandBuffers.push_back(buffer);
+    }
+
+    return item.commandBuffers[item.used++];
+}
+
+void Vulkan::BeginSecondaryBuffer(VkCommandBuffer cmd, const VkRenderPassBeginInfo &rpInfo)
+{
+    VkCommandBufferInheritanceInfo inheritance = {};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = rpInfo.renderPass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = rpInfo.framebuffer;
+
+    VkCommandBufferBeginInfo beginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+    beginInfo.pInheritanceInfo = &inheritance;
+
+    if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to begin secondary command buffer");
+    }
+}
+
+void Vulkan::SetRecordThreads(uint32_t threads)
+{
+    if (m_FrameBegin) {
+        throw Exceptions::EstException("Record threads cannot change during a frame");
+    }
+
+    // Secondary command buffers only pay off with thousands of submissions, opt in with a count
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    m_RecordPool.Stop();
+    m_RecordPool.Start(threads);
+}
+
+void Vulkan::ResizeBuffer(VulkanFrame &frame, VkDeviceSize vertices, VkDeviceSize indicies)
+{
+    auto result = VK_SUCCESS;
+
+    if (vertices > frame.maxVertexBufferSize) {
+        frame.maxVertexBufferSize = (uint32_t)vertices;
+    }
+
+    if (indicies > frame.maxIndexBufferSize) {
+        frame.maxIndexBufferSize = (uint32_t)indicies;
+    }
+
+    if (frame.vertexBuffer.buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(m_Vulkan.vkbDevice.device, frame.vertexBuffer.buffer, nullptr);
+        vkFreeMemory(m_Vulkan.vkbDevice.device, frame.vertexBuffer.memory, nullptr);
+    }
+
+    if (frame.indexBuffer.buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(m_Vulkan.vkbDevice.device, frame.indexBuffer.buffer, nullptr);
+        vkFreeMemory(m_Vulkan.vkbDevice.device, frame.indexBuffer.memory, nullptr);
+    }
+
+    {
+        VkBufferCreateInfo bufferInfo = {};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = vertices;
         bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        result = vkCreateBuffer(m_Vulkan.vkbDevice.device, &bufferInfo, nullptr, &m_Swapchain.vertexBuffer.buffer);
+        result = vkCreateBuffer(m_Vulkan.vkbDevice.device, &bufferInfo, nullptr, &frame.vertexBuffer.buffer);
         if (result != VK_SUCCESS) {
             throw Exceptions::EstException("Failed to create vertex buffer");
         }
 
         VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(m_Vulkan.vkbDevice.device, m_Swapchain.vertexBuffer.buffer, &memRequirements);
+        vkGetBufferMemoryRequirements(m_Vulkan.vkbDevice.device, frame.vertexBuffer.buffer, &memRequirements);
 
         VkMemoryAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
@@ -966,13 +1710,13 @@ void Vulkan::ResizeBuffer(VkDeviceSize vertices, VkDeviceSize indicies)
             memRequirements.memoryTypeBits,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-        result = vkAllocateMemory(m_Vulkan.vkbDevice.device, &allocInfo, nullptr, &m_Swapchain.vertexBuffer.memory);
+        result = vkAllocateMemory(m_Vulkan.vkbDevice.device, &allocInfo, nullptr, &frame.vertexBuffer.memory);
 
         if (result != VK_SUCCESS) {
             throw Exceptions::EstException("Failed to allocate vertex buffer memory");
         }
 
-        vkBindBufferMemory(m_Vulkan.vkbDevice.device, m_Swapchain.vertexBuffer.buffer, m_Swapchain.vertexBuffer.memory, 0);
+        vkBindBufferMemory(m_Vulkan.vkbDevice.device, frame.vertexBuffer.buffer, frame.vertexBuffer.memory, 0);
     }
 
     {
@@ -982,13 +1726,13 @@ void Vulkan::ResizeBuffer(VkDeviceSize vertices, VkDeviceSize indicies)
         bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        result = vkCreateBuffer(m_Vulkan.vkbDevice.device, &bufferInfo, nullptr, &m_Swapchain.indexBuffer.buffer);
+        result = vkCreateBuffer(m_Vulkan.vkbDevice.device, &bufferInfo, nullptr, &frame.indexBuffer.buffer);
         if (result != VK_SUCCESS) {
             throw Exceptions::EstException("Failed to create index buffer");
         }
 
         VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(m_Vulkan.vkbDevice.device, m_Swapchain.indexBuffer.buffer, &memRequirements);
+        vkGetBufferMemoryRequirements(m_Vulkan.vkbDevice.device, frame.indexBuffer.buffer, &memRequirements);
 
         VkMemoryAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
@@ -998,16 +1742,111 @@ void Vulkan::ResizeBuffer(VkDeviceSize vertices, VkDeviceSize indicies)
             memRequirements.memoryTypeBits,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-        result = vkAllocateMemory(m_Vulkan.vkbDevice.device, &allocInfo, nullptr, &m_Swapchain.indexBuffer.memory);
+        result = vkAllocateMemory(m_Vulkan.vkbDevice.device, &allocInfo, nullptr, &frame.indexBuffer.memory);
 
         if (result != VK_SUCCESS) {
             throw Exceptions::EstException("Failed to allocate index buffer memory");
         }
 
-        vkBindBufferMemory(m_Vulkan.vkbDevice.device, m_Swapchain.indexBuffer.buffer, m_Swapchain.indexBuffer.memory, 0);
+        vkBindBufferMemory(m_Vulkan.vkbDevice.device, frame.indexBuffer.buffer, frame.indexBuffer.memory, 0);
     }
 }
 
+void Vulkan::ResizeDrawBuffers(VulkanFrame &frame, uint32_t draws)
+{
+    // Grow geometrically, the count changes a little from frame to frame
+    uint32_t capacity = std::max<uint32_t>(frame.maxDraws, 1024);
+    while (capacity < draws) {
+        capacity *= 2;
+    }
+
+    auto device = m_Vulkan.vkbDevice.device;
+
+    if (frame.drawParamsSet == VK_NULL_HANDLE) {
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_Vulkan.descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &m_Vulkan.drawParamsLayout;
+
+        if (vkAllocateDescriptorSets(device, &allocInfo, &frame.drawParamsSet) != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to allocate draw parameters descriptor set");
+        }
+
+        auto target = &frame;
+        m_SwapchainDeletionQueue.push_function([=]() {
+            vkDestroyBuffer(device, target->indirectBuffer.buffer, nullptr);
+            vkFreeMemory(device, target->indirectBuffer.memory, nullptr);
+
+            vkDestroyBuffer(device, target->drawParamsBuffer.buffer, nullptr);
+            vkFreeMemory(device, target->drawParamsBuffer.memory, nullptr);
+
+            vkFreeDescriptorSets(device, m_Vulkan.descriptorPool, 1, &target->drawParamsSet);
+        });
+    }
+
+    auto create = [&](VulkanBuffer &buffer, void *&mapped, VkDeviceSize size, VkBufferUsageFlags usage) {
+        if (buffer.buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(device, buffer.buffer, nullptr);
+            vkFreeMemory(device, buffer.memory, nullptr);
+        }
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        auto result = vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to create draw buffer");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, buffer.buffer, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = vkinit::find_memory_type(
+            m_Vulkan.vkbDevice.physical_device,
+            memRequirements.memoryTypeBits,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        result = vkAllocateMemory(device, &allocInfo, nullptr, &buffer.memory);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to allocate draw buffer memory");
+        }
+
+        vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0);
+
+        result = vkMapMemory(device, buffer.memory, 0, size, 0, &mapped);
+        if (result != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to map draw buffer");
+        }
+    };
+
+    create(frame.indirectBuffer, frame.indirectCommands, capacity * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    create(frame.drawParamsBuffer, frame.drawParams, capacity * sizeof(DrawParams), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+    frame.maxDraws = capacity;
+
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = frame.drawParamsBuffer.buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet write = {};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = frame.drawParamsSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
 VulkanDescriptor *Vulkan::CreateDescriptor()
 {
     auto descriptor = std::make_unique<VulkanDescriptor>();
@@ -1029,7 +1868,7 @@ void Vulkan::DestroyDescriptor(VulkanDescriptor *descriptor, bool _delete)
     auto imageMemory = descriptor->ImageMemory;
     auto vkId = descriptor->VkId;
 
-    m_PerFrameDeletionQueue.push_function([=] {
+    m_PerFrameDeletionQueue.push_function(m_CurrentFrame, [=] {
         vkFreeMemory(device, uploadBufferMemory, nullptr);
         vkDestroyBuffer(device, uploadBuffer, nullptr);
         vkDestroySampler(device, sampler, nullptr);
@@ -1055,6 +1894,180 @@ VulkanObject *Vulkan::GetVulkanObject()
     return &m_Vulkan;
 }
 
+RenderTargetHandle Vulkan::CreateRenderTarget(Rect rect)
+{
+    if (rect.Width <= 0 || rect.Height <= 0) {
+        throw Exceptions::EstException("Invalid render target size");
+    }
+
+    auto device = m_Vulkan.vkbDevice.device;
+    auto allocate = [&](VkImage image, VkDeviceMemory *memory) {
+        VkMemoryRequirements req;
+        vkGetImageMemoryRequirements(device, image, &req);
+
+        VkMemoryAllocateInfo alloc_info = {};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = req.size;
+        alloc_info.memoryTypeIndex = vkinit::find_memory_type(
+            m_Vulkan.vkbDevice.physical_device,
+            req.memoryTypeBits,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(device, &alloc_info, nullptr, memory) != VK_SUCCESS) {
+            throw Exceptions::EstException("Failed to allocate render target memory");
+        }
+
+        vkBindImageMemory(device, image, *memory, 0);
+    };
+
+    VulkanRenderTarget target = {};
+    target.rect = rect;
+    target.descriptor = CreateDescriptor();
+
+    auto descriptor = target.descriptor;
+    descriptor->Size = { 0, 0, rect.Width, rect.Height };
+    descriptor->Channels = 4;
+
+    VkExtent3D extent = { (uint32_t)rect.Width, (uint32_t)rect.Height, 1 };
+
+    VkImageCreateInfo image_info = vkinit::image_create_info(
+        m_Vulkan.swapchainFormat,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        extent);
+
+    if (vkCreateImage(device, &image_info, nullptr, &descriptor->Image) != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create render target image");
+    }
+
+    allocate(descriptor->Image, &descriptor->ImageMemory);
+
+    VkImageViewCreateInfo view_info = vkinit::imageview_create_info(m_Vulkan.swapchainFormat, descriptor->Image, VK_IMAGE_ASPECT_COLOR_BIT);
+    if (vkCreateImageView(device, &view_info, nullptr, &descriptor->ImageView) != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create render target image view");
+    }
+
+    VkImageCreateInfo depth_info = vkinit::image_create_info(m_Vulkan.depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, extent);
+    if (vkCreateImage(device, &depth_info, nullptr, &target.depthImage) != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create render target depth image");
+    }
+
+    allocate(target.depthImage, &target.depthImageMemory);
+
+    VkImageViewCreateInfo depth_view_info = vkinit::imageview_create_info(m_Vulkan.depthFormat, target.depthImage, VK_IMAGE_ASPECT_DEPTH_BIT);
+    if (vkCreateImageView(device, &depth_view_info, nullptr, &target.depthImageView) != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create render target depth image view");
+    }
+
+    VkSamplerCreateInfo sampler_info = vkinit::sampler_create_info(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+    if (vkCreateSampler(device, &sampler_info, nullptr, &descriptor->Sampler) != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create render target sampler");
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = m_Vulkan.descriptorPool;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &m_Vulkan.descriptorSetLayout;
+    if (vkAllocateDescriptorSets(device, &alloc_info, &descriptor->VkId) != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create render target descriptor set");
+    }
+
+    VkDescriptorImageInfo desc_image = {};
+    desc_image.sampler = descriptor->Sampler;
+    desc_image.imageView = descriptor->ImageView;
+    desc_image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write_desc = vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, descriptor->VkId, &desc_image, 0);
+    vkUpdateDescriptorSets(device, 1, &write_desc, 0, nullptr);
+
+    VkExtent2D              fb_extent = { extent.width, extent.height };
+    VkFramebufferCreateInfo fb_info = vkinit::framebuffer_create_info(m_Swapchain.offscreenRenderpass, fb_extent);
+
+    VkImageView attachments[2] = { descriptor->ImageView, target.depthImageView };
+    fb_info.attachmentCount = 2;
+    fb_info.pAttachments = attachments;
+
+    if (vkCreateFramebuffer(device, &fb_info, nullptr, &target.framebuffer) != VK_SUCCESS) {
+        throw Exceptions::EstException("Failed to create render target framebuffer");
+    }
+
+    // Sampling a target before its first pass must still see a valid layout
+    VkImage image = descriptor->Image;
+    ImmediateSubmit([=](VkCommandBuffer cmd) {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = 1;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+    });
+
+    RenderTargetHandle handle = ++m_RenderTargetId;
+    m_RenderTargets[handle] = std::move(target);
+
+    return handle;
+}
+
+void Vulkan::DestroyRenderTarget(RenderTargetHandle handle)
+{
+    auto it = m_RenderTargets.find(handle);
+    if (it == m_RenderTargets.end()) {
+        return;
+    }
+
+    auto device = m_Vulkan.vkbDevice.device;
+    auto framebuffer = it->second.framebuffer;
+    auto depthImageView = it->second.depthImageView;
+    auto depthImage = it->second.depthImage;
+    auto depthImageMemory = it->second.depthImageMemory;
+
+    m_PerFrameDeletionQueue.push_function(m_CurrentFrame, [=] {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+        vkDestroyImageView(device, depthImageView, nullptr);
+        vkDestroyImage(device, depthImage, nullptr);
+        vkFreeMemory(device, depthImageMemory, nullptr);
+    });
+
+    DestroyDescriptor(it->second.descriptor);
+    m_RenderTargets.erase(it);
+
+    m_TargetOrder.erase(std::remove(m_TargetOrder.begin(), m_TargetOrder.end(), handle), m_TargetOrder.end());
+    if (m_CurrentTarget == handle) {
+        m_CurrentTarget = kBackbuffer;
+    }
+}
+
+void Vulkan::SetRenderTarget(RenderTargetHandle handle)
+{
+    if (handle != kBackbuffer) {
+        if (m_RenderTargets.find(handle) == m_RenderTargets.end()) {
+            throw Exceptions::EstException("Invalid render target");
+        }
+
+        if (std::find(m_TargetOrder.begin(), m_TargetOrder.end(), handle) == m_TargetOrder.end()) {
+            m_TargetOrder.push_back(handle);
+        }
+    }
+
+    m_CurrentTarget = handle;
+}
+
+const void *Vulkan::GetRenderTargetImage(RenderTargetHandle handle)
+{
+    auto it = m_RenderTargets.find(handle);
+    if (it == m_RenderTargets.end()) {
+        return nullptr;
+    }
+
+    return (const void *)it->second.descriptor->VkId;
+}
+
 VulkanSwapChain *Vulkan::GetSwapchain()
 {
     return &m_Swapchain;
@@ -1101,10 +2114,10 @@ BlendHandle Vulkan::CreateBlendState(TextureBlendInfo blendInfo)
             push_constants[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
             push_constants[0].offset = 0;
             push_constants[0].size = sizeof(PushConstant);
-            VkDescriptorSetLayout      set_layout[1] = { image_descriptor_layout };
+            VkDescriptorSetLayout      set_layout[2] = { image_descriptor_layout, m_Vulkan.drawParamsLayout };
             VkPipelineLayoutCreateInfo layout_info = {};
             layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-            layout_info.setLayoutCount = 1;
+            layout_info.setLayoutCount = 2;
             layout_info.pSetLayouts = set_layout;
             layout_info.pushConstantRangeCount = 1;
             layout_info.pPushConstantRanges = push_constants;
@@ -1133,130 +2146,183 @@ BlendHandle Vulkan::CreateBlendState(TextureBlendInfo blendInfo)
     VulkanRenderPipeline blendResult = {};
     blendResult.handle = handleId;
 
+    std::vector<std::pair<ShaderKey, std::pair<VkShaderModule, VkShaderModule>>> variants;
     for (auto &[type, shader_pair] : shaders) {
-        VkPipelineShaderStageCreateInfo stage[2] = {};
-        stage[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        stage[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-        stage[0].module = shader_pair.first;
-        stage[0].pName = "main";
-        stage[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        stage[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        stage[1].module = shader_pair.second;
-        stage[1].pName = "main";
-
-        VkVertexInputBindingDescription binding_desc[1] = {};
-        binding_desc[0].stride = sizeof(Vertex);
-        binding_desc[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        VkVertexInputAttributeDescription attribute_desc[3] = {};
-        attribute_desc[0].location = 0;
-        attribute_desc[0].binding = binding_desc[0].binding;
-        attribute_desc[0].format = VK_FORMAT_R32G32_SFLOAT;
-        attribute_desc[0].offset = MY_OFFSETOF(Vertex, pos);
-        attribute_desc[1].location = 1;
-        attribute_desc[1].binding = binding_desc[0].binding;
-        attribute_desc[1].format = VK_FORMAT_R32G32_SFLOAT;
-        attribute_desc[1].offset = MY_OFFSETOF(Vertex, texCoord);
-        attribute_desc[2].location = 2;
-        attribute_desc[2].binding = binding_desc[0].binding;
-        attribute_desc[2].format = VK_FORMAT_R8G8B8A8_UNORM;
-        attribute_desc[2].offset = MY_OFFSETOF(Vertex, color);
-        // attribute_desc[3].location = 3;
-        // attribute_desc[3].binding = binding_desc[0].binding;
-        // attribute_desc[3].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-        // attribute_desc[3].offset = MY_OFFSETOF(Vertex, cornerRadius);
-
-        VkPipelineVertexInputStateCreateInfo vertex_info = {};
-        vertex_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertex_info.vertexBindingDescriptionCount = 1;
-        vertex_info.pVertexBindingDescriptions = binding_desc;
-        vertex_info.vertexAttributeDescriptionCount = sizeof(attribute_desc) / sizeof(attribute_desc[0]);
-        vertex_info.pVertexAttributeDescriptions = attribute_desc;
-
-        VkPipelineInputAssemblyStateCreateInfo ia_info = {};
-        ia_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        ia_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        ia_info.primitiveRestartEnable = VK_FALSE;
-
-        VkPipelineViewportStateCreateInfo viewport_info = {};
-        viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewport_info.viewportCount = 1;
-        viewport_info.scissorCount = 1;
-
-        VkPipelineRasterizationStateCreateInfo raster_info = {};
-        raster_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        raster_info.polygonMode = VK_POLYGON_MODE_FILL;
-        raster_info.cullMode = VK_CULL_MODE_NONE;
-        raster_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-        raster_info.lineWidth = 1.0f;
-
-        VkPipelineMultisampleStateCreateInfo ms_info = {};
-        ms_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        ms_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-        VkPipelineDepthStencilStateCreateInfo depth_info = {};
-        depth_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-
-        VkPipelineColorBlendStateCreateInfo blend_info = {};
-        blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        blend_info.attachmentCount = 1;
-
-        VkDynamicState                   dynamic_states[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-        VkPipelineDynamicStateCreateInfo dynamic_state = {};
-        dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamic_state.dynamicStateCount = (uint32_t)(sizeof(dynamic_states) / sizeof(dynamic_states[0]));
-        dynamic_state.pDynamicStates = dynamic_states;
-
-        VkPipeline pipeline;
-        {
-            VkPipelineColorBlendAttachmentState color_attachment[1] = {};
-            if (blendInfo.Enable) {
-                color_attachment[0].blendEnable = VK_TRUE;
-                color_attachment[0].srcColorBlendFactor = static_cast<VkBlendFactor>(blendInfo.SrcColor);
-                color_attachment[0].dstColorBlendFactor = static_cast<VkBlendFactor>(blendInfo.DstColor);
-                color_attachment[0].colorBlendOp = static_cast<VkBlendOp>(blendInfo.ColorOp);
-                color_attachment[0].srcAlphaBlendFactor = static_cast<VkBlendFactor>(blendInfo.SrcAlpha);
-                color_attachment[0].dstAlphaBlendFactor = static_cast<VkBlendFactor>(blendInfo.DstAlpha);
-                color_attachment[0].alphaBlendOp = static_cast<VkBlendOp>(blendInfo.AlphaOp);
-                color_attachment[0].colorWriteMask =
-                    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-            } else {
-                color_attachment[0].blendEnable = VK_FALSE;
-            }
+        variants.push_back({ { type, ShaderVariant::Square }, shader_pair });
+        variants.push_back({ { type, ShaderVariant::Rounded }, shader_pair });
+    }
 
-            blend_info.pAttachments = color_attachment;
-
-            VkGraphicsPipelineCreateInfo info = {};
-            info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-            info.flags = 0;
-            info.stageCount = 2;
-            info.pStages = stage;
-            info.pVertexInputState = &vertex_info;
-            info.pInputAssemblyState = &ia_info;
-            info.pViewportState = &viewport_info;
-            info.pRasterizationState = &raster_info;
-            info.pMultisampleState = &ms_info;
-            info.pDepthStencilState = &depth_info;
-            info.pColorBlendState = &blend_info;
-            info.pDynamicState = &dynamic_state;
-            info.layout = m_Swapchain.pipelineLayout;
-            info.renderPass = m_Swapchain.renderpass;
-            info.subpass = 0;
-
-            result = vkCreateGraphicsPipelines(m_Vulkan.vkbDevice.device, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline);
+    // Drivers compile pipelines independently, the variants of a state are built at once
+    std::vector<VkPipeline> pipelines(variants.size(), VK_NULL_HANDLE);
+    JobSystem::Get()->ParallelFor(variants.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto &[key, shader_pair] = variants[i];
+
+            int32_t cornerMode = (int32_t)key.second;
+
+            VkSpecializationMapEntry specialization_entry = {};
+            specialization_entry.constantID = 0;
+            specialization_entry.offset = 0;
+            specialization_entry.size = sizeof(cornerMode);
+
+            VkSpecializationInfo specialization_info = {};
+            specialization_info.mapEntryCount = 1;
+            specialization_info.pMapEntries = &specialization_entry;
+            specialization_info.dataSize = sizeof(cornerMode);
+            specialization_info.pData = &cornerMode;
+
+            VkPipelineShaderStageCreateInfo stage[2] = {};
+            stage[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stage[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+            stage[0].module = shader_pair.first;
+            stage[0].pName = "main";
+            stage[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stage[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+            stage[1].module = shader_pair.second;
+            stage[1].pName = "main";
+            stage[1].pSpecializationInfo = &specialization_info;
+
+            VkVertexInputBindingDescription binding_desc[1] = {};
+            binding_desc[0].stride = sizeof(Vertex);
+            binding_desc[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+            VkVertexInputAttributeDescription attribute_desc[3] = {};
+            attribute_desc[0].location = 0;
+            attribute_desc[0].binding = binding_desc[0].binding;
+            attribute_desc[0].format = VK_FORMAT_R32G32_SFLOAT;
+            attribute_desc[0].offset = MY_OFFSETOF(Vertex, pos);
+            attribute_desc[1].location = 1;
+            attribute_desc[1].binding = binding_desc[0].binding;
+            attribute_desc[1].format = VK_FORMAT_R32G32_SFLOAT;
+            attribute_desc[1].offset = MY_OFFSETOF(Vertex, texCoord);
+            attribute_desc[2].location = 2;
+            attribute_desc[2].binding = binding_desc[0].binding;
+            attribute_desc[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+            attribute_desc[2].offset = MY_OFFSETOF(Vertex, color);
+            // attribute_desc[3].location = 3;
+            // attribute_desc[3].binding = binding_desc[0].binding;
+            // attribute_desc[3].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            // attribute_desc[3].offset = MY_OFFSETOF(Vertex, cornerRadius);
+
+            if (m_VertexFormat == VertexFormat::Compact) {
+                binding_desc[0].stride = sizeof(CompactVertex);
+                attribute_desc[0].format = VK_FORMAT_R16G16_SNORM;
+                attribute_desc[0].offset = MY_OFFSETOF(CompactVertex, pos);
+                attribute_desc[1].format = VK_FORMAT_R16G16_UNORM;
+                attribute_desc[1].offset = MY_OFFSETOF(CompactVertex, texCoord);
+                attribute_desc[2].offset = MY_OFFSETOF(CompactVertex, color);
+            }
 
-            if (result != VK_SUCCESS) {
-                throw Exceptions::EstException("Failed to create graphics pipeline");
+            VkPipelineVertexInputStateCreateInfo vertex_info = {};
+            vertex_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+            vertex_info.vertexBindingDescriptionCount = 1;
+            vertex_info.pVertexBindingDescriptions = binding_desc;
+            vertex_info.vertexAttributeDescriptionCount = sizeof(attribute_desc) / sizeof(attribute_desc[0]);
+            vertex_info.pVertexAttributeDescriptions = attribute_desc;
+
+            VkPipelineInputAssemblyStateCreateInfo ia_info = {};
+            ia_info.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+            ia_info.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            ia_info.primitiveRestartEnable = VK_FALSE;
+
+            VkPipelineViewportStateCreateInfo viewport_info = {};
+            viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+            viewport_info.viewportCount = 1;
+            viewport_info.scissorCount = 1;
+
+            VkPipelineRasterizationStateCreateInfo raster_info = {};
+            raster_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+            raster_info.polygonMode = VK_POLYGON_MODE_FILL;
+            raster_info.cullMode = VK_CULL_MODE_NONE;
+            raster_info.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+            raster_info.lineWidth = 1.0f;
+
+            VkPipelineMultisampleStateCreateInfo ms_info = {};
+            ms_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+            ms_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+            VkPipelineDepthStencilStateCreateInfo depth_info = {};
+            depth_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+            depth_info.depthTestEnable = VK_TRUE;
+            depth_info.depthWriteEnable = handleId == DefaultBlend::NONE ? VK_TRUE : VK_FALSE;
+            depth_info.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+            depth_info.maxDepthBounds = 1.0f;
+
+            VkPipelineColorBlendStateCreateInfo blend_info = {};
+            blend_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+            blend_info.attachmentCount = 1;
+
+            VkDynamicState                   dynamic_states[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+            VkPipelineDynamicStateCreateInfo dynamic_state = {};
+            dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+            dynamic_state.dynamicStateCount = (uint32_t)(sizeof(dynamic_states) / sizeof(dynamic_states[0]));
+            dynamic_state.pDynamicStates = dynamic_states;
+
+            VkPipeline pipeline;
+            {
+                VkPipelineColorBlendAttachmentState color_attachment[1] = {};
+                if (blendInfo.Enable) {
+                    color_attachment[0].blendEnable = VK_TRUE;
+                    color_attachment[0].srcColorBlendFactor = static_cast<VkBlendFactor>(blendInfo.SrcColor);
+                    color_attachment[0].dstColorBlendFactor = static_cast<VkBlendFactor>(blendInfo.DstColor);
+                    color_attachment[0].colorBlendOp = static_cast<VkBlendOp>(blendInfo.ColorOp);
+                    color_attachment[0].srcAlphaBlendFactor = static_cast<VkBlendFactor>(blendInfo.SrcAlpha);
+                    color_attachment[0].dstAlphaBlendFactor = static_cast<VkBlendFactor>(blendInfo.DstAlpha);
+                    color_attachment[0].alphaBlendOp = static_cast<VkBlendOp>(blendInfo.AlphaOp);
+                    color_attachment[0].colorWriteMask =
+                        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+                } else {
+                    color_attachment[0].blendEnable = VK_FALSE;
+                }
+
+                blend_info.pAttachments = color_attachment;
+
+                VkGraphicsPipelineCreateInfo info = {};
+                info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+                info.flags = 0;
+                info.stageCount = 2;
+                info.pStages = stage;
+                info.pVertexInputState = &vertex_info;
+                info.pInputAssemblyState = &ia_info;
+                info.pViewportState = &viewport_info;
+                info.pRasterizationState = &raster_info;
+                info.pMultisampleState = &ms_info;
+                info.pDepthStencilState = &depth_info;
+                info.pColorBlendState = &blend_info;
+                info.pDynamicState = &dynamic_state;
+                info.layout = m_Swapchain.pipelineLayout;
+                info.renderPass = m_Swapchain.renderpass;
+                info.subpass = 0;
+
+                if (vkCreateGraphicsPipelines(m_Vulkan.vkbDevice.device, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline) != VK_SUCCESS) {
+                    pipeline = VK_NULL_HANDLE;
+                }
             }
+
+            pipelines[i] = pipeline;
         }
+    });
 
-        blendResult.pipelines[type] = pipeline;
+    // Whatever did compile is still owned by the deletion queue when one of them failed
+    bool failed = false;
+    for (size_t i = 0; i < variants.size(); i++) {
+        VkPipeline pipeline = pipelines[i];
+        if (pipeline == VK_NULL_HANDLE) {
+            failed = true;
+            continue;
+        }
+
+        blendResult.pipelines[variants[i].first] = pipeline;
 
         m_DeletionQueue.push_function([=] {
             vkDestroyPipeline(m_Vulkan.vkbDevice.device, pipeline, nullptr);
         });
     }
 
+    if (failed) {
+        throw Exceptions::EstException("Failed to create graphics pipeline");
+    }
+
     m_BlendStates[handleId] = std::move(blendResult);
     return handleId;
 }
@@ -1313,8 +2379,9 @@ void Vulkan::ImGui_Init()
     init_info.Device = m_Vulkan.vkbDevice.device;
     init_info.Queue = m_Vulkan.graphicsQueue;
     init_info.DescriptorPool = imguiPool;
-    init_info.MinImageCount = 3;
-    init_info.ImageCount = 3;
+    uint32_t imageCount = (uint32_t)m_Swapchain.images.size();
+    init_info.MinImageCount = std::max(m_SwapchainInfo.imageCount, 2u);
+    init_info.ImageCount = std::max({ imageCount, init_info.MinImageCount, (uint32_t)m_Swapchain.frames.size() + 1 });
     init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 
     ImGui_ImplVulkan_Init(&init_info, m_Swapchain.renderpass);
@@ -8,6 +8,7 @@
 
 #include "./Volk/volk.h"
 #include "./VulkanBootstrap/VkBootstrap.h"
+#include "../WorkerPool.h"
 #include "VulkanDescriptor.h"
 #include <Graphics/GraphicsBackendBase.h>
 
@@ -30,6 +31,34 @@ struct DeletionQueue
     }
 };
 
+// Deletions tagged with the frame that may still reference them, run once that frame completed
+struct FrameDeletionQueue
+{
+    std::deque<std::pair<uint64_t, std::function<void()>>> deletors;
+
+    void push_function(uint64_t frame, std::function<void()> &&function)
+    {
+        deletors.push_back({ frame, function });
+    }
+
+    void flush(uint64_t completedFrame)
+    {
+        while (deletors.size() && deletors.front().first <= completedFrame) {
+            deletors.front().second();
+            deletors.pop_front();
+        }
+    }
+
+    void flush()
+    {
+        for (auto &deletor : deletors) {
+            deletor.second();
+        }
+
+        deletors.clear();
+    }
+};
+
 namespace Graphics {
     namespace Backends {
         struct VulkanObject
@@ -46,6 +75,14 @@ namespace Graphics {
 
             VkDescriptorPool      descriptorPool;
             VkDescriptorSetLayout descriptorSetLayout;
+            VkDescriptorSetLayout drawParamsLayout;
+
+            // multiDrawIndirect and drawIndirectFirstInstance, without them draws are issued one by one
+            bool     indirectDraw;
+            uint32_t maxDrawIndirectCount;
+
+            // Nanoseconds per timestamp tick, 0 when the graphics queue has no timestamps
+            float timestampPeriod;
 
             VkShaderModule vertShaderModule;
             VkShaderModule solidFragShaderModule;
@@ -58,6 +95,14 @@ namespace Graphics {
             VkDeviceMemory memory;
         };
 
+        // Secondary command buffers of one recording thread, reset with the frame
+        struct VulkanRecorder
+        {
+            VkCommandPool                commandPool;
+            std::vector<VkCommandBuffer> commandBuffers;
+            size_t                       used;
+        };
+
         struct VulkanFrame
         {
             VkSemaphore presentSemaphore;
@@ -67,6 +112,28 @@ namespace Graphics {
             VkCommandPool   commandPool;
             VkCommandBuffer commandBuffer;
 
+            // Each frame in flight streams its geometry through its own buffers
+            uint32_t maxVertexBufferSize;
+            uint32_t maxIndexBufferSize;
+
+            VulkanBuffer vertexBuffer;
+            VulkanBuffer indexBuffer;
+
+            // Indirect commands and their parameters, one slot per submission, mapped while they live
+            uint32_t        maxDraws;
+            VulkanBuffer    indirectBuffer;
+            VulkanBuffer    drawParamsBuffer;
+            void           *indirectCommands;
+            void           *drawParams;
+            VkDescriptorSet drawParamsSet;
+
+            // One per recording thread, created on first use
+            std::vector<VulkanRecorder> recorders;
+
+            // Pass timestamps, read back once renderFence signaled
+            VkQueryPool queryPool;
+            bool        queriesWritten;
+
             bool isValid;
         };
 
@@ -80,26 +147,44 @@ namespace Graphics {
             VulkanFrame              uploadContext;
             VkPipelineLayout         pipelineLayout;
 
-            uint32_t maxVertexBufferSize;
-            uint32_t maxIndexBufferSize;
-
-            VulkanBuffer vertexBuffer;
-            VulkanBuffer indexBuffer;
-
             VkImage        depthImage;
             VkImageView    depthImageView;
             VkDeviceMemory depthImageMemory;
 
             vkb::Swapchain swapchain;
+
+            // Headless mode renders into these instead of swapchain images
+            std::vector<VkDeviceMemory> headlessMemory;
+            VkExtent2D                  headlessExtent;
+
             VkRenderPass   renderpass;
+            VkRenderPass   offscreenRenderpass;
             uint32_t       imageCount;
             uint32_t       swapchainIndex;
+
+            // Hash of the frame each swapchain image currently holds, 0 when unknown
+            std::vector<uint64_t> imageHashes;
         };
 
         struct VulkanRenderPipeline
         {
             BlendHandle                              handle;
-            std::map<ShaderFragmentType, VkPipeline> pipelines;
+            std::map<ShaderKey, VkPipeline> pipelines;
+        };
+
+        struct VulkanRenderTarget
+        {
+            Rect rect;
+
+            // Color image, view and sampler live in the descriptor
+            VulkanDescriptor *descriptor;
+
+            VkImage        depthImage;
+            VkImageView    depthImageView;
+            VkDeviceMemory depthImageMemory;
+            VkFramebuffer  framebuffer;
+
+            std::vector<SubmitInfo> submitInfos;
         };
 
         struct VulkanImGui
@@ -112,6 +197,9 @@ namespace Graphics {
         public:
             virtual ~Vulkan() = default;
 
+            virtual void SetVertexFormat(VertexFormat format) override;
+            virtual void SetSwapchainInfo(SwapchainInfo info) override;
+
             virtual void Init() override;
             virtual void ReInit() override;
             virtual void Shutdown() override;
@@ -121,6 +209,8 @@ namespace Graphics {
             virtual bool BeginFrame() override;
             virtual void EndFrame() override;
 
+            virtual void WaitForPresent() override;
+
             virtual void ImGui_Init() override;
             virtual void ImGui_DeInit() override;
             virtual void ImGui_NewFrame() override;
@@ -134,6 +224,21 @@ namespace Graphics {
 
             virtual BlendHandle CreateBlendState(TextureBlendInfo blendInfo) override;
 
+            virtual RenderTargetHandle CreateRenderTarget(Rect rect) override;
+            virtual void               DestroyRenderTarget(RenderTargetHandle handle) override;
+            virtual void               SetRenderTarget(RenderTargetHandle handle) override;
+            virtual const void        *GetRenderTargetImage(RenderTargetHandle handle) override;
+
+            virtual bool Represent(uint64_t hash) override;
+
+            virtual void SetRecordThreads(uint32_t threads) override;
+
+            virtual void RequestCapture() override;
+            virtual bool ReadCapture(std::vector<uint8_t> &pixels, int &width, int &height) override;
+
+            virtual GpuTimings GetGpuTimings() override;
+            virtual void       SetImGuiDrawData(ImDrawData *data) override;
+
             /* Internal */
             VulkanDescriptor *CreateDescriptor();
             void              DestroyDescriptor(VulkanDescriptor *descriptor, bool _delete = true);
@@ -149,13 +254,23 @@ namespace Graphics {
             void InitFramebuffers();
             void InitCommands();
             void InitSyncStructures();
+            void InitQueries();
             void InitDescriptors();
             void InitShaders();
             void InitPipeline();
             bool InitSwapchain();
-
-            void         FlushQueue();
-            void         ResizeBuffer(VkDeviceSize vertices, VkDeviceSize indices);
+            bool InitHeadlessImages(Rect rect);
+            void InitDepthImage(VkExtent2D extent);
+            void CaptureImage(uint32_t index);
+            void ReadTimestamps(VulkanFrame &frame);
+            void WriteTimestamp(VkCommandBuffer cmd, VkPipelineStageFlagBits stage, uint32_t query);
+
+            void            FlushQueue();
+            bool            RecordQueue(VkCommandBuffer cmd, const VkRenderPassBeginInfo &rpInfo, std::vector<SubmitInfo> &queue, Rect rect, uint32_t &vertexBase, uint32_t &indexBase, uint32_t &drawBase);
+            VkCommandBuffer GetSecondaryBuffer(VulkanFrame &frame, uint32_t recorder);
+            void            BeginSecondaryBuffer(VkCommandBuffer cmd, const VkRenderPassBeginInfo &rpInfo);
+            void         ResizeBuffer(VulkanFrame &frame, VkDeviceSize vertices, VkDeviceSize indices);
+            void         ResizeDrawBuffers(VulkanFrame &frame, uint32_t draws);
             VulkanFrame &GetCurrentFrame();
             VulkanFrame &GetLastFrame();
 
@@ -167,7 +282,7 @@ namespace Graphics {
             DeletionQueue m_DeletionQueue;
 
             // OnFrame program clean up, like deleting texture
-            DeletionQueue m_PerFrameDeletionQueue;
+            FrameDeletionQueue m_PerFrameDeletionQueue;
 
             // OnSwapchain program clean up, like re-creating swapchain
             DeletionQueue m_SwapchainDeletionQueue;
@@ -175,6 +290,25 @@ namespace Graphics {
             bool m_SwapchainReady;
             bool m_Initialized;
             bool m_FrameBegin;
+            bool m_Represent = false;
+
+            // The main pass was begun for secondary buffers, ImGui has to be recorded into one too
+            bool                  m_MainPassSecondary = false;
+            VkRenderPassBeginInfo m_MainPassInfo = {};
+            WorkerPool            m_RecordPool;
+
+            // Read back after the next submit, headless only
+            bool                 m_CaptureRequested = false;
+            std::vector<uint8_t> m_Capture;
+
+            GpuTimings m_GpuTimings;
+
+            ImDrawData *m_ImGuiDrawData = nullptr;
+
+            VertexFormat  m_VertexFormat = VertexFormat::Float;
+            SwapchainInfo m_SwapchainInfo;
+
+            uint64_t m_FrameHash = 0;
 
             uint32_t m_CurrentFrame = 0;
 
@@ -187,6 +321,12 @@ namespace Graphics {
 
             // Alpha blending
             std::map<BlendHandle, VulkanRenderPipeline> m_BlendStates;
+
+            // Offscreen targets, m_TargetOrder is the order they were first used this frame
+            std::map<RenderTargetHandle, VulkanRenderTarget> m_RenderTargets;
+            std::vector<RenderTargetHandle>                  m_TargetOrder;
+            RenderTargetHandle                               m_CurrentTarget = kBackbuffer;
+            RenderTargetHandle                               m_RenderTargetId = 0;
         };
     } // namespace Backends
 } // namespace Graphics
@@ -22,9 +22,15 @@ VKTexture2D::~VKTexture2D()
 {
     if (Descriptor) {
         auto renderer = Graphics::Renderer::Get();
+        renderer->UnregisterTexture(GetId());
+
         if (renderer->GetAPI() == Graphics::API::Vulkan) {
             auto vulkan = (Graphics::Backends::Vulkan *)renderer->GetBackend();
-            vulkan->DestroyDescriptor(Descriptor);
+            auto descriptor = Descriptor;
+
+            renderer->Invoke([=]() {
+                vulkan->DestroyDescriptor(descriptor);
+            });
         }
     }
 }
@@ -81,6 +87,8 @@ void VKTexture2D::Load(const char *pixbuf, uint32_t width, uint32_t height)
     auto vulkan = (Graphics::Backends::Vulkan *)renderer->GetBackend();
     auto vkobject = vulkan->GetVulkanObject();
 
+    Opaque = IsOpaquePixels(pixbuf, width, height);
+
     if (!Descriptor) {
         Descriptor = vulkan->CreateDescriptor();
         Descriptor->Channels = 4;
@@ -0,0 +1,28 @@
+#include "WorkerPool.h"
+#include <Threads/JobSystem.h>
+#include <algorithm>
+using namespace Graphics::Backends;
+
+void WorkerPool::Start(uint32_t threads)
+{
+    this->threads = std::max(threads, 1u);
+}
+
+void WorkerPool::Stop()
+{
+    threads = 1;
+}
+
+uint32_t WorkerPool::GetThreads()
+{
+    return std::min(threads, JobSystem::Get()->GetThreads() + 1);
+}
+
+void WorkerPool::Run(uint32_t count, const std::function<void(uint32_t)> &job)
+{
+    JobSystem::Get()->ParallelFor(count, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            job((uint32_t)i);
+        }
+    });
+}
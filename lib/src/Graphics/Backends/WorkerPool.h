@@ -0,0 +1,24 @@
+#ifndef __WORKERPOOL_H_
+#define __WORKERPOOL_H_
+
+#include <cstdint>
+#include <functional>
+
+namespace Graphics {
+    namespace Backends {
+        // How many JobSystem threads a backend's parallel loops may use, Run() also uses the calling thread
+        struct WorkerPool
+        {
+            void     Start(uint32_t threads);
+            void     Stop();
+            uint32_t GetThreads();
+
+            // Calls job(0..count-1) once each and returns when all finished, rethrows what a job threw
+            void Run(uint32_t count, const std::function<void(uint32_t)> &job);
+
+            uint32_t threads = 1;
+        };
+    } // namespace Backends
+} // namespace Graphics
+
+#endif
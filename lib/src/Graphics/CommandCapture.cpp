@@ -0,0 +1,347 @@
+#include <Exceptions/EstException.h>
+#include <Graphics/CommandCapture.h>
+#include <cstring>
+#include <fstream>
+using namespace Graphics;
+using namespace Graphics::Backends;
+
+namespace {
+    // "ESTC", then a version bumped on any layout change. Everything is little-endian
+    const uint32_t kMagic = 0x43545345;
+    const uint32_t kVersion = 1;
+
+    struct Writer
+    {
+        std::vector<uint8_t> data;
+
+        void U8(uint8_t value)
+        {
+            data.push_back(value);
+        }
+
+        void U16(uint16_t value)
+        {
+            data.push_back((uint8_t)value);
+            data.push_back((uint8_t)(value >> 8));
+        }
+
+        void U32(uint32_t value)
+        {
+            for (int i = 0; i < 4; i++) {
+                data.push_back((uint8_t)(value >> (i * 8)));
+            }
+        }
+
+        void U64(uint64_t value)
+        {
+            for (int i = 0; i < 8; i++) {
+                data.push_back((uint8_t)(value >> (i * 8)));
+            }
+        }
+
+        void F32(float value)
+        {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            U32(bits);
+        }
+
+        void I32(int32_t value) { U32((uint32_t)value); }
+
+        void Vec2(glm::vec2 value)
+        {
+            F32(value.x);
+            F32(value.y);
+        }
+
+        void Vec4(glm::vec4 value)
+        {
+            F32(value.x);
+            F32(value.y);
+            F32(value.z);
+            F32(value.w);
+        }
+
+        void Rectangle(const Rect &rect)
+        {
+            I32(rect.X);
+            I32(rect.Y);
+            I32(rect.Width);
+            I32(rect.Height);
+        }
+    };
+
+    struct Reader
+    {
+        const std::vector<uint8_t> &data;
+        size_t                      offset;
+        std::string                 path;
+
+        const uint8_t *Take(size_t size)
+        {
+            if (data.size() - offset < size) {
+                throw Exceptions::EstException("Truncated command capture: " + path);
+            }
+
+            const uint8_t *bytes = data.data() + offset;
+            offset += size;
+            return bytes;
+        }
+
+        uint8_t U8() { return *Take(1); }
+
+        uint16_t U16()
+        {
+            const uint8_t *bytes = Take(2);
+            return (uint16_t)(bytes[0] | (bytes[1] << 8));
+        }
+
+        uint32_t U32()
+        {
+            const uint8_t *bytes = Take(4);
+
+            uint32_t value = 0;
+            for (int i = 0; i < 4; i++) {
+                value |= (uint32_t)bytes[i] << (i * 8);
+            }
+
+            return value;
+        }
+
+        uint64_t U64()
+        {
+            uint64_t low = U32();
+            uint64_t high = U32();
+            return low | (high << 32);
+        }
+
+        float F32()
+        {
+            uint32_t bits = U32();
+
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        int32_t I32() { return (int32_t)U32(); }
+
+        glm::vec2 Vec2()
+        {
+            float x = F32();
+            float y = F32();
+            return glm::vec2(x, y);
+        }
+
+        glm::vec4 Vec4()
+        {
+            float x = F32();
+            float y = F32();
+            float z = F32();
+            float w = F32();
+            return glm::vec4(x, y, z, w);
+        }
+
+        Rect Rectangle()
+        {
+            Rect rect;
+            rect.X = I32();
+            rect.Y = I32();
+            rect.Width = I32();
+            rect.Height = I32();
+            return rect;
+        }
+
+        // Element counts are checked against what is left before anything gets allocated
+        uint32_t Count(size_t elementSize)
+        {
+            uint32_t count = U32();
+            if ((data.size() - offset) / elementSize < count) {
+                throw Exceptions::EstException("Truncated command capture: " + path);
+            }
+
+            return count;
+        }
+    };
+} // namespace
+
+void CommandCapture::Write(std::filesystem::path path) const
+{
+    Writer out;
+    out.U32(kMagic);
+    out.U32(kVersion);
+
+    out.U32((uint32_t)textures.size());
+    for (auto &[hash, texture] : textures) {
+        out.U64(hash);
+        out.U32(texture.width);
+        out.U32(texture.height);
+        out.U8(texture.opaque);
+    }
+
+    out.U32((uint32_t)blends.size());
+    for (auto &[hash, blend] : blends) {
+        out.U64(hash);
+        out.U8(blend.builtin);
+        out.U32(blend.handle);
+        out.U8(blend.info.Enable);
+        out.U32((uint32_t)blend.info.SrcColor);
+        out.U32((uint32_t)blend.info.DstColor);
+        out.U32((uint32_t)blend.info.ColorOp);
+        out.U32((uint32_t)blend.info.SrcAlpha);
+        out.U32((uint32_t)blend.info.DstAlpha);
+        out.U32((uint32_t)blend.info.AlphaOp);
+    }
+
+    out.U32((uint32_t)targets.size());
+    for (auto &[handle, rect] : targets) {
+        out.U32(handle);
+        out.Rectangle(rect);
+    }
+
+    out.U32((uint32_t)frames.size());
+    for (auto &frame : frames) {
+        out.I32(frame.width);
+        out.I32(frame.height);
+
+        out.U32((uint32_t)frame.submissions.size());
+        for (auto &submission : frame.submissions) {
+            auto &info = submission.info;
+
+            out.U32(submission.target);
+            out.U64(submission.imageHash);
+            out.U32(submission.imageTarget);
+            out.U64(submission.blendHash);
+
+            out.U8((uint8_t)info.fragmentType);
+            out.U8(info.opaqueImage);
+            out.I32(info.zIndex);
+            out.Rectangle(info.clipRect);
+            out.Vec2(info.uiSize);
+            out.Vec4(info.uiRadius);
+            out.Vec4(info.transform);
+            out.Vec2(info.pivot);
+            out.Vec2(info.offset);
+
+            out.U32((uint32_t)info.vertices.size());
+            for (auto &vertex : info.vertices) {
+                out.Vec2(vertex.pos);
+                out.Vec2(vertex.texCoord);
+                out.U32(vertex.color);
+            }
+
+            out.U32((uint32_t)info.indices.size());
+            for (uint16_t index : info.indices) {
+                out.U16(index);
+            }
+        }
+    }
+
+    std::ofstream fs(path, std::ios::out | std::ios::binary);
+    if (!fs.is_open()) {
+        throw Exceptions::EstException("Failed to open file: " + path.string());
+    }
+
+    fs.write((const char *)out.data.data(), out.data.size());
+    if (!fs) {
+        throw Exceptions::EstException("Failed to write file: " + path.string());
+    }
+}
+
+CommandCapture CommandCapture::Read(std::filesystem::path path)
+{
+    std::ifstream fs(path, std::ios::in | std::ios::binary);
+    if (!fs.is_open()) {
+        throw Exceptions::EstException("Failed to open file: " + path.string());
+    }
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+
+    Reader in = { data, 0, path.string() };
+    if (in.U32() != kMagic || in.U32() != kVersion) {
+        throw Exceptions::EstException("Not a command capture or unsupported version: " + path.string());
+    }
+
+    CommandCapture capture;
+
+    uint32_t textureCount = in.Count(17);
+    for (uint32_t i = 0; i < textureCount; i++) {
+        uint64_t hash = in.U64();
+
+        Texture texture;
+        texture.width = in.U32();
+        texture.height = in.U32();
+        texture.opaque = in.U8() != 0;
+
+        capture.textures[hash] = texture;
+    }
+
+    uint32_t blendCount = in.Count(38);
+    for (uint32_t i = 0; i < blendCount; i++) {
+        uint64_t hash = in.U64();
+
+        Blend blend;
+        blend.builtin = in.U8() != 0;
+        blend.handle = in.U32();
+        blend.info.Enable = in.U8() != 0;
+        blend.info.SrcColor = (BlendFactor)in.U32();
+        blend.info.DstColor = (BlendFactor)in.U32();
+        blend.info.ColorOp = (BlendOp)in.U32();
+        blend.info.SrcAlpha = (BlendFactor)in.U32();
+        blend.info.DstAlpha = (BlendFactor)in.U32();
+        blend.info.AlphaOp = (BlendOp)in.U32();
+
+        capture.blends[hash] = blend;
+    }
+
+    uint32_t targetCount = in.Count(20);
+    for (uint32_t i = 0; i < targetCount; i++) {
+        RenderTargetHandle handle = in.U32();
+        capture.targets[handle] = in.Rectangle();
+    }
+
+    uint32_t frameCount = in.Count(12);
+    capture.frames.resize(frameCount);
+
+    for (auto &frame : capture.frames) {
+        frame.width = in.I32();
+        frame.height = in.I32();
+
+        uint32_t submissionCount = in.Count(110);
+        frame.submissions.resize(submissionCount);
+
+        for (auto &submission : frame.submissions) {
+            auto &info = submission.info;
+
+            submission.target = in.U32();
+            submission.imageHash = in.U64();
+            submission.imageTarget = in.U32();
+            submission.blendHash = in.U64();
+
+            info.fragmentType = (ShaderFragmentType)in.U8();
+            info.opaqueImage = in.U8() != 0;
+            info.zIndex = in.I32();
+            info.clipRect = in.Rectangle();
+            info.uiSize = in.Vec2();
+            info.uiRadius = in.Vec4();
+            info.transform = in.Vec4();
+            info.pivot = in.Vec2();
+            info.offset = in.Vec2();
+            info.alphablend = DefaultBlend::NONE;
+
+            info.vertices.resize(in.Count(20));
+            for (auto &vertex : info.vertices) {
+                vertex.pos = in.Vec2();
+                vertex.texCoord = in.Vec2();
+                vertex.color = in.U32();
+            }
+
+            info.indices.resize(in.Count(2));
+            for (auto &index : info.indices) {
+                index = in.U16();
+            }
+        }
+    }
+
+    return capture;
+}
@@ -1,6 +1,8 @@
 #include <Exceptions/EstException.h>
 #include <Graphics/NativeWindow.h>
 #include <Graphics/Renderer.h>
+#include <algorithm>
+#include <cmath>
 
 using namespace Graphics;
 
@@ -22,13 +24,17 @@ void NativeWindow::Destroy()
     }
 }
 
-void NativeWindow::Init(std::string title, int width, int height, API graphics, bool fullscreen)
+void NativeWindow::Init(std::string title, int width, int height, API graphics, bool fullscreen, bool headless)
 {
     Uint32 flags = 0;
-    if (fullscreen) {
+    if (fullscreen && !headless) {
         flags |= SDL_WINDOW_FULLSCREEN;
     }
 
+    if (headless) {
+        flags |= SDL_WINDOW_HIDDEN;
+    }
+
     switch (graphics) {
         case API::OpenGL:
         {
@@ -38,7 +44,16 @@ void NativeWindow::Init(std::string title, int width, int height, API graphics,
 
         case API::Vulkan:
         {
-            flags |= SDL_WINDOW_VULKAN;
+            // The backend renders without a surface, which SDL's offscreen driver couldn't provide anyway
+            if (!headless) {
+                flags |= SDL_WINDOW_VULKAN;
+            }
+            break;
+        }
+
+        case API::Software:
+        {
+            // Presented through SDL_GetWindowSurface, no graphics API on the window
             break;
         }
 
@@ -55,6 +70,8 @@ void NativeWindow::Init(std::string title, int width, int height, API graphics,
 
     m_Window = std::unique_ptr<SDL_Window, SDLWindowSmartDeallocator>(Window);
     m_WindowRect = { 0, 0, width, height };
+
+    UpdateRefreshRate();
 }
 
 NativeWindow::~NativeWindow()
@@ -80,6 +97,24 @@ void NativeWindow::SetWindowSize(Rect size)
     m_WindowRect = size;
 }
 
+double NativeWindow::GetRefreshRate()
+{
+    return m_RefreshRate;
+}
+
+void NativeWindow::UpdateRefreshRate()
+{
+    SDL_DisplayMode mode = {};
+
+    int display = SDL_GetWindowDisplayIndex(m_Window.get());
+    if (display < 0 || SDL_GetCurrentDisplayMode(display, &mode) != 0) {
+        m_RefreshRate = 0.0;
+        return;
+    }
+
+    m_RefreshRate = (double)mode.refresh_rate;
+}
+
 SDL_Window *NativeWindow::GetWindow()
 {
     return m_Window.get();
@@ -89,15 +124,50 @@ void NativeWindow::PumpEvents()
 {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
-        switch (event.type) {
-            case SDL_QUIT:
-                m_ShouldExit = true;
-                break;
-        }
+        DispatchEvent(event);
+    }
+}
 
-        for (auto &callback : m_Callbacks) {
-            callback(event);
-        }
+bool NativeWindow::WaitEvents(double timeout)
+{
+    SDL_Event event;
+    if (!SDL_WaitEventTimeout(&event, std::max((int)std::ceil(timeout * 1000.0), 1))) {
+        return false;
+    }
+
+    DispatchEvent(event);
+    PumpEvents();
+
+    return true;
+}
+
+void NativeWindow::DispatchEvent(SDL_Event &event)
+{
+    switch (event.type) {
+        case SDL_QUIT:
+            m_ShouldExit = true;
+            break;
+
+        case SDL_WINDOWEVENT:
+            // Moving is enough to land on another display, older SDL has no event for the change itself
+            if (event.window.event == SDL_WINDOWEVENT_MOVED
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+                || event.window.event == SDL_WINDOWEVENT_DISPLAY_CHANGED
+#endif
+            ) {
+                UpdateRefreshRate();
+            }
+            break;
+
+#if SDL_VERSION_ATLEAST(2, 0, 9)
+        case SDL_DISPLAYEVENT:
+            UpdateRefreshRate();
+            break;
+#endif
+    }
+
+    for (auto &callback : m_Callbacks) {
+        callback(event);
     }
 }
 
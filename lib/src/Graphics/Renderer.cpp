@@ -1,14 +1,66 @@
 #include "./Backends/OpenGL/OpenGLBackend.h"
 #include "./Backends/OpenGL/OpenGLTexture2D.h"
+#include "./Backends/Software/SoftwareBackend.h"
+#include "./Backends/Software/SoftwareTexture2D.h"
 #include "./Backends/Vulkan/VulkanBackend.h"
 #include "./Backends/Vulkan/VulkanTexture2D.h"
 #include <Exceptions/EstException.h>
+#include <Graphics/NativeWindow.h>
 #include <Graphics/Renderer.h>
+#include <Graphics/Utils/stb_image.h>
+#include <Imgui/imgui.h>
+#include <Misc/Filesystem.h>
+#include <Misc/Png.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <thread>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RENDERER_BOUNDS_SSE
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RENDERER_BOUNDS_NEON
+#endif
 using namespace Graphics;
 
 Renderer *Renderer::s_Instance = nullptr;
 
+struct Renderer::Pipeline
+{
+    std::thread::id thread;
+
+    std::mutex                             mutex;
+    std::condition_variable                condition;
+    std::deque<std::packaged_task<void()>> tasks;
+
+    // Handed over by EndFrame, the building thread only touches it while rendering is false
+    FrameList          frame;
+    bool               rendering = false;
+    std::exception_ptr error;
+
+    // ImGui rebuilds its lists on the next NewFrame, the render thread draws from copies
+    ImDrawData                imgui;
+    std::vector<ImDrawList *> imguiLists;
+
+    Backends::GpuTimings gpuTimings;
+
+    ~Pipeline()
+    {
+        for (auto list : imguiLists) {
+            IM_DELETE(list);
+        }
+    }
+};
+
 Renderer *Renderer::Get()
 {
     if (s_Instance == nullptr) {
@@ -33,12 +85,14 @@ Renderer::~Renderer()
     }
 }
 
-void Renderer::Init(API api, TextureSamplerInfo sampler)
+void Renderer::Init(API api, TextureSamplerInfo sampler, Backends::VertexFormat vertexFormat, Backends::SwapchainInfo swapchain)
 {
     using namespace Backends;
 
     m_API = api;
     m_Sampler = sampler;
+    m_Swapchain = swapchain;
+    m_VertexFormat = vertexFormat;
 
     Base *backend = nullptr;
     switch (api) {
@@ -54,17 +108,37 @@ void Renderer::Init(API api, TextureSamplerInfo sampler)
             break;
         }
 
+        case API::Software:
+        {
+            backend = new Software();
+            break;
+        }
+
         default:
         {
             throw Exceptions::EstException("Unknown API");
         }
     }
 
+    backend->SetVertexFormat(vertexFormat);
+    backend->SetSwapchainInfo(swapchain);
     backend->Init();
 
     m_Backend = backend;
 }
 
+void Renderer::WaitForPresent()
+{
+    if (!m_Swapchain.waitForPresent || m_onFrame) {
+        return;
+    }
+
+    // Pipelined, this waits for the queued frame as well
+    Invoke([this]() {
+        m_Backend->WaitForPresent();
+    });
+}
+
 Backends::Base *Renderer::GetBackend()
 {
     return m_Backend;
@@ -75,9 +149,178 @@ API Renderer::GetAPI()
     return m_API;
 }
 
+// Bounds of the untransformed positions, two vertices per vector, NaN positions are skipped like std::min does
+static void GetPositionBounds(const Graphics::Backends::SubmitInfo &info, glm::vec2 &min, glm::vec2 &max)
+{
+    const Graphics::Backends::Vertex *vertices = info.vertices.data();
+    size_t                            count = info.vertices.size();
+    size_t                            i = 0;
+
+#if defined(RENDERER_BOUNDS_SSE)
+    __m128 lo = _mm_set1_ps(FLT_MAX);
+    __m128 hi = _mm_set1_ps(-FLT_MAX);
+    for (; i + 2 <= count; i += 2) {
+        __m128 pos = _mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)&vertices[i].pos);
+        pos = _mm_loadh_pi(pos, (const __m64 *)&vertices[i + 1].pos);
+
+        // Returns the second operand when either is NaN
+        lo = _mm_min_ps(pos, lo);
+        hi = _mm_max_ps(pos, hi);
+    }
+
+    lo = _mm_min_ps(lo, _mm_movehl_ps(lo, lo));
+    hi = _mm_max_ps(hi, _mm_movehl_ps(hi, hi));
+
+    float bounds[2][4];
+    _mm_storeu_ps(bounds[0], lo);
+    _mm_storeu_ps(bounds[1], hi);
+#elif defined(RENDERER_BOUNDS_NEON)
+    float32x4_t lo = vdupq_n_f32(FLT_MAX);
+    float32x4_t hi = vdupq_n_f32(-FLT_MAX);
+    for (; i + 2 <= count; i += 2) {
+        float32x4_t pos = vcombine_f32(vld1_f32(&vertices[i].pos.x), vld1_f32(&vertices[i + 1].pos.x));
+
+        // Returns the number when one operand is NaN
+        lo = vminnmq_f32(lo, pos);
+        hi = vmaxnmq_f32(hi, pos);
+    }
+
+    float bounds[2][4];
+    vst1_f32(bounds[0], vminnm_f32(vget_low_f32(lo), vget_high_f32(lo)));
+    vst1_f32(bounds[1], vmaxnm_f32(vget_low_f32(hi), vget_high_f32(hi)));
+#else
+    float bounds[2][4] = { { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } };
+#endif
+
+    float minX = bounds[0][0], minY = bounds[0][1];
+    float maxX = bounds[1][0], maxY = bounds[1][1];
+    for (; i < count; i++) {
+        minX = std::min(minX, vertices[i].pos.x);
+        minY = std::min(minY, vertices[i].pos.y);
+        maxX = std::max(maxX, vertices[i].pos.x);
+        maxY = std::max(maxY, vertices[i].pos.y);
+    }
+
+    min = { minX, minY };
+    max = { maxX, maxY };
+}
+
+static bool IsCulled(const Graphics::Backends::SubmitInfo &info, glm::vec2 min, glm::vec2 max, const Rect &viewport)
+{
+    if (info.vertices.size() == 0 || info.indices.size() == 0) {
+        return true;
+    }
+
+    float minX = min.x, minY = min.y;
+    float maxX = max.x, maxY = max.y;
+
+    // Bounds of the transformed box, the vertex shader applies the transform
+    if (info.transform != glm::vec4(1.0f, 0.0f, 0.0f, 1.0f) || info.offset != glm::vec2(0.0f)) {
+        glm::mat2 matrix(info.transform.x, info.transform.y, info.transform.z, info.transform.w);
+        glm::vec2 corners[4] = {
+            { minX, minY }, { maxX, minY }, { minX, maxY }, { maxX, maxY }
+        };
+
+        minX = minY = FLT_MAX;
+        maxX = maxY = -FLT_MAX;
+        for (auto &corner : corners) {
+            glm::vec2 pos = matrix * (corner - info.pivot) + info.pivot + info.offset;
+
+            minX = std::min(minX, pos.x);
+            minY = std::min(minY, pos.y);
+            maxX = std::max(maxX, pos.x);
+            maxY = std::max(maxY, pos.y);
+        }
+    }
+
+    int x0 = viewport.X;
+    int y0 = viewport.Y;
+    int x1 = viewport.X + viewport.Width;
+    int y1 = viewport.Y + viewport.Height;
+
+    // An empty clip rect means "not clipped" to stay safe for callers that never set one
+    if (info.clipRect.Width > 0 && info.clipRect.Height > 0) {
+        x0 = std::max(x0, info.clipRect.X);
+        y0 = std::max(y0, info.clipRect.Y);
+        x1 = std::min(x1, info.clipRect.X + info.clipRect.Width);
+        y1 = std::min(y1, info.clipRect.Y + info.clipRect.Height);
+    }
+
+    return x1 <= x0 || y1 <= y0
+           || maxX <= (float)x0 || minX >= (float)x1
+           || maxY <= (float)y0 || minY >= (float)y1;
+}
+
 void Renderer::Push(Graphics::Backends::SubmitInfo &info)
 {
-    m_Backend->Push(info);
+    Rect viewport = m_Viewport;
+    if (m_RenderTarget != Graphics::Backends::kBackbuffer) {
+        auto it = m_TargetRects.find(m_RenderTarget);
+        if (it != m_TargetRects.end()) {
+            viewport = it->second;
+        }
+    } else if (!m_onFrame) {
+        viewport = Graphics::NativeWindow::Get()->GetWindowSize();
+    }
+
+    // Moved into the target's space on a copy, callers push the same batches again every frame
+    Graphics::Backends::SubmitInfo  moved;
+    Graphics::Backends::SubmitInfo *submit = &info;
+    if (m_RenderTarget != Graphics::Backends::kBackbuffer && m_RenderTargetOrigin != glm::vec2(0.0f)) {
+        moved = info;
+        moved.offset -= m_RenderTargetOrigin;
+
+        if (moved.clipRect.Width > 0 && moved.clipRect.Height > 0) {
+            moved.clipRect.X -= (int)std::round(m_RenderTargetOrigin.x);
+            moved.clipRect.Y -= (int)std::round(m_RenderTargetOrigin.y);
+        }
+
+        submit = &moved;
+    }
+
+    glm::vec2 boundsMin, boundsMax;
+    GetPositionBounds(*submit, boundsMin, boundsMax);
+
+    if (IsCulled(*submit, boundsMin, boundsMax, viewport)) {
+        m_CulledSubmissions++;
+        return;
+    }
+
+    // Compact vertices only reach kCompactRange px from 0. Farther geometry is moved around 0 on a copy, and the
+    // pivot and offset take the move back, which the vertex shader undoes exactly
+    const float range = Graphics::Backends::kCompactRange;
+    bool        outOfRange = boundsMin.x < -range || boundsMin.y < -range || boundsMax.x > range || boundsMax.y > range;
+    if (m_VertexFormat == Graphics::Backends::VertexFormat::Compact && outOfRange) {
+        if (submit != &moved) {
+            moved = info;
+            submit = &moved;
+        }
+
+        // Whole pixels, the positions keep the same subpixel grid
+        glm::vec2 origin(std::round((boundsMin.x + boundsMax.x) * 0.5f), std::round((boundsMin.y + boundsMax.y) * 0.5f));
+        for (auto &vertex : moved.vertices) {
+            vertex.pos -= origin;
+        }
+
+        moved.pivot -= origin;
+        moved.offset += origin;
+    }
+
+    if (m_RecordFrames && m_onFrame && m_FrameIndex >= m_RecordFirstFrame) {
+        RecordSubmission(*submit);
+    }
+
+    if (m_RenderTarget != Graphics::Backends::kBackbuffer) {
+        m_TargetGenerations[m_RenderTarget] = ++m_TargetWrites;
+    }
+
+    if (!IsBuffered()) {
+        m_Backend->Push(*submit);
+        return;
+    }
+
+    m_Frame.submissions.push_back(*submit);
+    m_Frame.targets.push_back(m_RenderTarget);
 }
 
 bool Renderer::BeginFrame()
@@ -90,13 +333,24 @@ bool Renderer::BeginFrame()
         throw Exceptions::EstException("BeginFrame called without EndFrame");
     }
 
-    if (m_Backend->NeedReinit()) {
+    // Pipelined, the render thread does it before its next frame
+    if (!m_Pipeline && m_Backend->NeedReinit()) {
         m_Backend->ReInit();
     }
 
-    auto result = m_Backend->BeginFrame();
-    m_onFrame = result;
-    return result;
+    m_FrameIndex++;
+    m_Viewport = Graphics::NativeWindow::Get()->GetWindowSize();
+    m_RecordingFrame.submissions.clear();
+
+    if (!IsBuffered()) {
+        auto result = m_Backend->BeginFrame();
+        m_onFrame = result;
+        return result;
+    }
+
+    // The backend frame only starts in EndFrame, once we know the frame changed
+    m_onFrame = m_Viewport.Width > 0 && m_Viewport.Height > 0;
+    return m_onFrame;
 }
 
 void Renderer::EndFrame()
@@ -110,9 +364,479 @@ void Renderer::EndFrame()
     }
 
     m_onFrame = false;
+
+    if (m_RecordFrames && m_FrameIndex >= m_RecordFirstFrame) {
+        m_RecordingFrame.width = m_Viewport.Width;
+        m_RecordingFrame.height = m_Viewport.Height;
+        m_Recording.frames.push_back(std::move(m_RecordingFrame));
+        m_RecordingFrame = {};
+
+        if (--m_RecordFrames == 0) {
+            SaveRecording();
+        }
+    }
+
+    m_Frame.viewport = m_Viewport;
+    m_Frame.generation = m_Generation;
+    m_Frame.targetGenerations.assign(m_TargetGenerations.begin(), m_TargetGenerations.end());
+
+    if (m_Pipeline) {
+        QueueFrame();
+        return;
+    }
+
+    PresentFrame(m_Frame, ImGui::GetDrawData());
+
+    if (!m_CapturePath.empty()) {
+        SaveCapture();
+    }
+}
+
+bool Renderer::IsBuffered()
+{
+    return m_IdleMode != IdleMode::Always || m_Pipeline != nullptr;
+}
+
+void Renderer::PresentFrame(FrameList &frame, ImDrawData *imgui)
+{
+    if (!IsBuffered()) {
+        m_Backend->EndFrame();
+        return;
+    }
+
+    uint64_t hash = 0;
+    if (m_IdleMode != IdleMode::Always) {
+        hash = HashFrame(frame, imgui);
+        if (m_IdleMode == IdleMode::SkipUnchanged && hash == m_LastFrameHash) {
+            m_SkippedFrames++;
+            DiscardFrame(frame);
+            return;
+        }
+    }
+
+    if (!m_Backend->BeginFrame()) {
+        m_LastFrameHash = 0;
+        DiscardFrame(frame);
+        return;
+    }
+
+    m_LastFrameHash = hash;
+    if (m_IdleMode == IdleMode::Represent && m_Backend->Represent(hash)) {
+        m_SkippedFrames++;
+        DiscardFrame(frame);
+        return;
+    }
+
+    FlushFrame(frame);
     m_Backend->EndFrame();
 }
 
+static const uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+
+static uint64_t HashBytes(uint64_t hash, const void *data, size_t size)
+{
+    const uint64_t kPrime = 0x100000001b3ULL;
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+
+        hash = (hash ^ word) * kPrime;
+        hash ^= hash >> 32;
+    }
+
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * kPrime;
+    }
+
+    return hash;
+}
+
+template <typename T>
+static uint64_t HashValue(uint64_t hash, const T &value)
+{
+    return HashBytes(hash, &value, sizeof(value));
+}
+
+uint64_t Renderer::HashFrame(const FrameList &frame, ImDrawData *imgui)
+{
+    uint64_t hash = HashValue(kHashSeed, frame.generation);
+    hash = HashValue(hash, frame.viewport.Width);
+    hash = HashValue(hash, frame.viewport.Height);
+
+    for (auto handle : frame.activations) {
+        hash = HashValue(hash, handle);
+    }
+
+    // A cached target adds no submissions, what it was last drawn with still tells frames apart
+    for (auto &[handle, generation] : frame.targetGenerations) {
+        hash = HashValue(hash, handle);
+        hash = HashValue(hash, generation);
+    }
+
+    for (size_t i = 0; i < frame.submissions.size(); i++) {
+        auto &info = frame.submissions[i];
+
+        hash = HashValue(hash, frame.targets[i]);
+        hash = HashBytes(hash, info.vertices.data(), info.vertices.size() * sizeof(info.vertices[0]));
+        hash = HashBytes(hash, info.indices.data(), info.indices.size() * sizeof(info.indices[0]));
+        hash = HashValue(hash, info.uiSize);
+        hash = HashValue(hash, info.uiRadius);
+        hash = HashValue(hash, info.clipRect);
+        hash = HashValue(hash, info.zIndex);
+        hash = HashValue(hash, info.image);
+        hash = HashValue(hash, info.fragmentType);
+        hash = HashValue(hash, info.alphablend);
+        hash = HashValue(hash, info.transform);
+        hash = HashValue(hash, info.pivot);
+        hash = HashValue(hash, info.offset);
+    }
+
+    auto drawData = imgui;
+    if (drawData && drawData->Valid) {
+        hash = HashValue(hash, drawData->DisplaySize);
+
+        for (int i = 0; i < drawData->CmdListsCount; i++) {
+            auto list = drawData->CmdLists[i];
+
+            hash = HashBytes(hash, list->VtxBuffer.Data, list->VtxBuffer.size_in_bytes());
+            hash = HashBytes(hash, list->IdxBuffer.Data, list->IdxBuffer.size_in_bytes());
+
+            for (auto &cmd : list->CmdBuffer) {
+                hash = HashValue(hash, cmd.ClipRect);
+                hash = HashValue(hash, cmd.TextureId);
+                hash = HashValue(hash, cmd.VtxOffset);
+                hash = HashValue(hash, cmd.IdxOffset);
+                hash = HashValue(hash, cmd.ElemCount);
+            }
+        }
+    }
+
+    // 0 is reserved for "unknown content"
+    return hash ? hash : 1;
+}
+
+void Renderer::FlushFrame(FrameList &frame)
+{
+    using namespace Backends;
+
+    // Replay activations first, backends render targets in the order they were activated
+    for (auto handle : frame.activations) {
+        m_Backend->SetRenderTarget(handle);
+    }
+
+    RenderTargetHandle current = frame.activations.size() ? frame.activations.back() : kBackbuffer;
+    for (size_t i = 0; i < frame.submissions.size(); i++) {
+        if (frame.targets[i] != current) {
+            current = frame.targets[i];
+            m_Backend->SetRenderTarget(current);
+        }
+
+        m_Backend->Push(frame.submissions[i]);
+    }
+
+    m_Backend->SetRenderTarget(kBackbuffer);
+    DiscardFrame(frame);
+}
+
+void Renderer::DiscardFrame(FrameList &frame)
+{
+    frame.submissions.clear();
+    frame.targets.clear();
+    frame.activations.clear();
+    frame.targetGenerations.clear();
+}
+
+// ImVector's assignment frees before copying, resize keeps the capacity of the last frame
+template <typename T>
+static void CopyImVector(const ImVector<T> &source, ImVector<T> &copy)
+{
+    copy.resize(source.Size);
+    if (source.Size) {
+        memcpy(copy.Data, source.Data, (size_t)source.Size * sizeof(T));
+    }
+}
+
+static void CopyDrawData(const ImDrawData *source, ImDrawData &copy, std::vector<ImDrawList *> &lists)
+{
+    copy.Clear();
+    if (!source || !source->Valid) {
+        return;
+    }
+
+    while (lists.size() < (size_t)source->CmdListsCount) {
+        lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+    }
+
+    for (int i = 0; i < source->CmdListsCount; i++) {
+        auto list = lists[i];
+
+        CopyImVector(source->CmdLists[i]->CmdBuffer, list->CmdBuffer);
+        CopyImVector(source->CmdLists[i]->IdxBuffer, list->IdxBuffer);
+        CopyImVector(source->CmdLists[i]->VtxBuffer, list->VtxBuffer);
+        list->Flags = source->CmdLists[i]->Flags;
+
+        copy.CmdLists.push_back(list);
+    }
+
+    copy.Valid = true;
+    copy.CmdListsCount = source->CmdListsCount;
+    copy.TotalIdxCount = source->TotalIdxCount;
+    copy.TotalVtxCount = source->TotalVtxCount;
+    copy.DisplayPos = source->DisplayPos;
+    copy.DisplaySize = source->DisplaySize;
+    copy.FramebufferScale = source->FramebufferScale;
+}
+
+void Renderer::QueueFrame()
+{
+    auto &pipeline = *m_Pipeline;
+
+    {
+        std::unique_lock<std::mutex> lock(pipeline.mutex);
+        pipeline.condition.wait(lock, [&]() { return !pipeline.rendering; });
+
+        if (pipeline.error) {
+            auto error = pipeline.error;
+            pipeline.error = nullptr;
+
+            DiscardFrame(m_Frame);
+            std::rethrow_exception(error);
+        }
+    }
+
+    // The render thread cleared its lists, they are reused for the next frame
+    std::swap(m_Frame, pipeline.frame);
+    CopyDrawData(ImGui::GetDrawData(), pipeline.imgui, pipeline.imguiLists);
+
+    {
+        std::lock_guard<std::mutex> lock(pipeline.mutex);
+        pipeline.rendering = true;
+        pipeline.tasks.emplace_back([this]() {
+            RenderQueuedFrame();
+        });
+    }
+
+    pipeline.condition.notify_all();
+}
+
+void Renderer::RenderQueuedFrame()
+{
+    auto &pipeline = *m_Pipeline;
+
+    std::exception_ptr error;
+    try {
+        if (m_Backend->NeedReinit()) {
+            m_Backend->ReInit();
+        }
+
+        m_Backend->SetImGuiDrawData(&pipeline.imgui);
+        PresentFrame(pipeline.frame, &pipeline.imgui);
+        m_Backend->SetImGuiDrawData(nullptr);
+
+        if (!m_CapturePath.empty()) {
+            SaveCapture();
+        }
+    } catch (...) {
+        m_Backend->SetImGuiDrawData(nullptr);
+        DiscardFrame(pipeline.frame);
+
+        // Rethrown by the next EndFrame
+        error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pipeline.mutex);
+        pipeline.gpuTimings = m_Backend->GetGpuTimings();
+        pipeline.error = error;
+        pipeline.rendering = false;
+    }
+
+    pipeline.condition.notify_all();
+}
+
+void Renderer::SetPipelined(bool enabled)
+{
+    if (!m_Backend) {
+        throw Exceptions::EstException("Renderer backend not initialized");
+    }
+
+    if (m_onFrame) {
+        throw Exceptions::EstException("SetPipelined called during a frame");
+    }
+
+    if (enabled == (m_Pipeline != nullptr)) {
+        return;
+    }
+
+    if (enabled) {
+        DiscardFrame(m_Frame);
+
+        m_Pipeline = std::make_unique<Pipeline>();
+        m_Pipeline->thread = std::this_thread::get_id();
+        return;
+    }
+
+    if (std::this_thread::get_id() != m_Pipeline->thread) {
+        throw Exceptions::EstException("SetPipelined(false) called outside the render thread");
+    }
+
+    // Whatever was queued still runs, nothing may be building frames anymore
+    RenderPending(0.0);
+    m_Pipeline.reset();
+}
+
+bool Renderer::IsPipelined()
+{
+    return m_Pipeline != nullptr;
+}
+
+void Renderer::RenderPending(double timeout)
+{
+    if (!m_Pipeline) {
+        return;
+    }
+
+    auto &pipeline = *m_Pipeline;
+    auto  deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeout));
+
+    std::unique_lock<std::mutex> lock(pipeline.mutex);
+    if (!pipeline.condition.wait_until(lock, deadline, [&]() { return !pipeline.tasks.empty(); })) {
+        return;
+    }
+
+    while (!pipeline.tasks.empty()) {
+        auto task = std::move(pipeline.tasks.front());
+        pipeline.tasks.pop_front();
+
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+void Renderer::Invoke(std::function<void()> function)
+{
+    if (!m_Pipeline || std::this_thread::get_id() == m_Pipeline->thread) {
+        function();
+        return;
+    }
+
+    // Queued behind the frame being rendered, anything it still uses stays alive until it is done
+    std::packaged_task<void()> task(std::move(function));
+    auto                       result = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_Pipeline->mutex);
+        m_Pipeline->tasks.push_back(std::move(task));
+    }
+
+    m_Pipeline->condition.notify_all();
+
+    // Rethrows what function threw
+    result.get();
+}
+
+void Renderer::RecordCommands(std::string path, uint32_t frames)
+{
+    m_Recording = {};
+    m_RecordingFrame = {};
+    m_RecordPath = path;
+    m_RecordFrames = std::max(frames, 1u);
+
+    // A frame already begun would be captured partially
+    m_RecordFirstFrame = m_FrameIndex + 1;
+}
+
+void Renderer::RecordSubmission(const Graphics::Backends::SubmitInfo &info)
+{
+    using namespace Backends;
+
+    CommandCapture::Submission submission;
+    submission.info = info;
+    submission.info.image = nullptr;
+    submission.target = m_RenderTarget;
+
+    if (info.image) {
+        auto texture = m_TextureRecords.find(info.image);
+        if (texture != m_TextureRecords.end()) {
+            submission.imageHash = texture->second.first;
+            m_Recording.textures[texture->second.first] = texture->second.second;
+        } else {
+            for (auto &[handle, rect] : m_TargetRects) {
+                if (m_Backend->GetRenderTargetImage(handle) == info.image) {
+                    submission.imageTarget = handle;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Custom states hash their factors, so the same state created twice is one entry
+    CommandCapture::Blend blend;
+    blend.handle = info.alphablend;
+
+    uint64_t blendHash;
+    auto     custom = m_BlendInfos.find(info.alphablend);
+    if (custom != m_BlendInfos.end()) {
+        blend.builtin = false;
+        blend.info = custom->second;
+
+        blendHash = HashValue(kHashSeed, (uint8_t)1);
+        blendHash = HashValue(blendHash, blend.info.Enable);
+        blendHash = HashValue(blendHash, blend.info.SrcColor);
+        blendHash = HashValue(blendHash, blend.info.DstColor);
+        blendHash = HashValue(blendHash, blend.info.ColorOp);
+        blendHash = HashValue(blendHash, blend.info.SrcAlpha);
+        blendHash = HashValue(blendHash, blend.info.DstAlpha);
+        blendHash = HashValue(blendHash, blend.info.AlphaOp);
+    } else {
+        blendHash = HashValue(HashValue(kHashSeed, (uint8_t)0), blend.handle);
+    }
+
+    m_Recording.blends[blendHash] = blend;
+    submission.blendHash = blendHash;
+
+    for (auto handle : { submission.target, submission.imageTarget }) {
+        auto rect = m_TargetRects.find(handle);
+        if (rect != m_TargetRects.end()) {
+            m_Recording.targets[handle] = rect->second;
+        }
+    }
+
+    m_RecordingFrame.submissions.push_back(std::move(submission));
+}
+
+void Renderer::SaveRecording()
+{
+    auto recording = std::move(m_Recording);
+    m_Recording = {};
+
+    recording.Write(m_RecordPath);
+    m_RecordPath.clear();
+}
+
+void Renderer::RegisterTexture(Texture2D *texture, uint64_t hash, uint32_t width, uint32_t height)
+{
+    CommandCapture::Texture record;
+    record.width = width;
+    record.height = height;
+    record.opaque = texture->IsOpaque();
+
+    m_TextureRecords[texture->GetId()] = { hash, record };
+}
+
+void Renderer::UnregisterTexture(const void *id)
+{
+    m_TextureRecords.erase(id);
+}
+
+uint64_t Renderer::GetFrameIndex()
+{
+    return m_FrameIndex;
+}
+
 void Renderer::ImGui_NewFrame()
 {
     if (!m_Backend) {
@@ -128,9 +852,57 @@ void Renderer::ImGui_EndFrame()
         throw Exceptions::EstException("Renderer backend not initialized");
     }
 
+    if (m_GpuTimingsOverlay) {
+        DrawGpuTimings();
+    }
+
     m_Backend->ImGui_EndFrame();
 }
 
+Backends::GpuTimings Renderer::GetGpuTimings()
+{
+    if (!m_Backend) {
+        return {};
+    }
+
+    // The backend writes them while rendering, other threads read what the last queued frame left
+    if (m_Pipeline && std::this_thread::get_id() != m_Pipeline->thread) {
+        std::lock_guard<std::mutex> lock(m_Pipeline->mutex);
+        return m_Pipeline->gpuTimings;
+    }
+
+    return m_Backend->GetGpuTimings();
+}
+
+void Renderer::SetGpuTimingsOverlay(bool enabled)
+{
+    m_GpuTimingsOverlay = enabled;
+}
+
+void Renderer::DrawGpuTimings()
+{
+    auto timings = GetGpuTimings();
+
+    ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings |
+                             ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoInputs;
+
+    ImGui::SetNextWindowPos(ImVec2(8.0f, 8.0f), ImGuiCond_Always);
+    ImGui::SetNextWindowBgAlpha(0.6f);
+
+    if (ImGui::Begin("GPU Timings", nullptr, flags)) {
+        if (timings.valid) {
+            ImGui::Text("GPU     %6.2f ms", timings.total);
+            ImGui::Text("Targets %6.2f ms", timings.targets);
+            ImGui::Text("Main    %6.2f ms", timings.main);
+            ImGui::Text("ImGui   %6.2f ms", timings.imgui);
+        } else {
+            ImGui::TextUnformatted("GPU timings unavailable");
+        }
+    }
+
+    ImGui::End();
+}
+
 Texture2D *CreateTexture(API api, TextureSamplerInfo sampler)
 {
     Texture2D *texture = nullptr;
@@ -147,6 +919,12 @@ Texture2D *CreateTexture(API api, TextureSamplerInfo sampler)
             texture = new GLTexture2D(sampler);
             break;
         }
+
+        case API::Software:
+        {
+            texture = new SWTexture2D(sampler);
+            break;
+        }
     }
 
     return texture;
@@ -154,19 +932,29 @@ Texture2D *CreateTexture(API api, TextureSamplerInfo sampler)
 
 Texture2D *Renderer::LoadTexture(std::filesystem::path path)
 {
-    auto texture = CreateTexture(GetAPI(), m_Sampler);
+    auto data = Misc::Filesystem::ReadFile(path);
 
-    texture->Load(path);
-
-    return texture;
+    return LoadTexture((const char *)data.data(), data.size());
 }
 
 Texture2D *Renderer::LoadTexture(const char *buf, size_t size)
 {
-    auto texture = CreateTexture(GetAPI(), m_Sampler);
+    // Decoded here rather than by the texture, captures identify it by its pixels
+    int            width = 0, height = 0, channels = 0;
+    unsigned char *pixels = stbi_load_from_memory((const unsigned char *)buf, (int)size, &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        throw Exceptions::EstException("Failed to load texture");
+    }
 
-    texture->Load(buf, size);
+    Texture2D *texture = nullptr;
+    try {
+        texture = LoadTexture((const char *)pixels, (uint32_t)width, (uint32_t)height);
+    } catch (...) {
+        stbi_image_free(pixels);
+        throw;
+    }
 
+    stbi_image_free(pixels);
     return texture;
 }
 
@@ -174,12 +962,180 @@ Texture2D *Renderer::LoadTexture(const char *pixbuf, uint32_t width, uint32_t he
 {
     auto texture = CreateTexture(GetAPI(), m_Sampler);
 
-    texture->Load(pixbuf, width, height);
+    try {
+        Invoke([&]() {
+            texture->Load(pixbuf, width, height);
+        });
+    } catch (...) {
+        delete texture;
+        throw;
+    }
+
+    // Pixels are only hashed while a recording is pending, other textures are told apart by load order
+    uint64_t hash;
+    if (m_RecordFrames > 0) {
+        hash = HashBytes(HashValue(kHashSeed, (uint8_t)0), pixbuf, (size_t)width * height * 4);
+    } else {
+        hash = HashValue(HashValue(kHashSeed, (uint8_t)1), ++m_TextureLoads);
+    }
+
+    RegisterTexture(texture, hash, width, height);
 
     return texture;
 }
 
 Graphics::Backends::BlendHandle Renderer::CreateBlendState(Graphics::Backends::TextureBlendInfo info)
 {
-    return m_Backend->CreateBlendState(info);
-}
\ No newline at end of file
+    Graphics::Backends::BlendHandle handle;
+    Invoke([&]() {
+        handle = m_Backend->CreateBlendState(info);
+    });
+
+    m_BlendInfos[handle] = info;
+
+    return handle;
+}
+
+Graphics::Backends::RenderTargetHandle Renderer::CreateRenderTarget(Rect rect)
+{
+    Graphics::Backends::RenderTargetHandle handle;
+    Invoke([&]() {
+        handle = m_Backend->CreateRenderTarget(rect);
+    });
+
+    m_TargetRects[handle] = rect;
+
+    return handle;
+}
+
+void Renderer::DestroyRenderTarget(Graphics::Backends::RenderTargetHandle handle)
+{
+    if (m_RenderTarget == handle) {
+        m_RenderTarget = Graphics::Backends::kBackbuffer;
+        m_RenderTargetOrigin = glm::vec2(0.0f);
+    }
+
+    m_TargetRects.erase(handle);
+    m_TargetGenerations.erase(handle);
+
+    // Drop anything still held for the target
+    auto &activations = m_Frame.activations;
+    activations.erase(std::remove(activations.begin(), activations.end(), handle), activations.end());
+    for (size_t i = m_Frame.submissions.size(); i-- > 0;) {
+        if (m_Frame.targets[i] == handle) {
+            m_Frame.submissions.erase(m_Frame.submissions.begin() + i);
+            m_Frame.targets.erase(m_Frame.targets.begin() + i);
+        }
+    }
+
+    // A queued frame drawing to it is rendered first
+    Invoke([&]() {
+        m_Backend->DestroyRenderTarget(handle);
+    });
+}
+
+void Renderer::SetRenderTarget(Graphics::Backends::RenderTargetHandle handle, glm::vec2 origin)
+{
+    if (!IsBuffered()) {
+        m_Backend->SetRenderTarget(handle);
+    } else if (handle != Graphics::Backends::kBackbuffer) {
+        auto &activations = m_Frame.activations;
+        if (std::find(activations.begin(), activations.end(), handle) == activations.end()) {
+            activations.push_back(handle);
+        }
+    }
+
+    m_RenderTarget = handle;
+    m_RenderTargetOrigin = handle != Graphics::Backends::kBackbuffer ? origin : glm::vec2(0.0f);
+}
+
+Graphics::Backends::RenderTargetHandle Renderer::GetRenderTarget()
+{
+    return m_RenderTarget;
+}
+
+glm::vec2 Renderer::GetRenderTargetOrigin()
+{
+    return m_RenderTargetOrigin;
+}
+
+const void *Renderer::GetRenderTargetImage(Graphics::Backends::RenderTargetHandle handle)
+{
+    // Targets only change through Invoke, reading them from the building thread is safe
+    return m_Backend->GetRenderTargetImage(handle);
+}
+
+
+void Renderer::CaptureFrame(std::string path)
+{
+    if (!m_Backend) {
+        throw Exceptions::EstException("Renderer backend not initialized");
+    }
+
+    Invoke([&]() {
+        m_Backend->RequestCapture();
+        m_CapturePath = path;
+    });
+}
+
+void Renderer::SaveCapture()
+{
+    std::vector<uint8_t> pixels;
+    int                  width = 0, height = 0;
+
+    // Skipped frames never reached the backend, the request stays pending
+    if (!m_Backend->ReadCapture(pixels, width, height)) {
+        return;
+    }
+
+    auto path = m_CapturePath;
+    m_CapturePath.clear();
+
+    Misc::Png::Write(path, pixels, width, height);
+}
+
+void Renderer::SetRecordThreads(uint32_t threads)
+{
+    if (m_onFrame) {
+        throw Exceptions::EstException("SetRecordThreads called during a frame");
+    }
+
+    Invoke([&]() {
+        m_Backend->SetRecordThreads(threads);
+    });
+}
+
+void Renderer::SetIdleMode(IdleMode mode)
+{
+    if (m_onFrame) {
+        throw Exceptions::EstException("SetIdleMode called during a frame");
+    }
+
+    DiscardFrame(m_Frame);
+
+    // Both are read by the render thread while presenting
+    Invoke([&]() {
+        m_IdleMode = mode;
+        m_LastFrameHash = 0;
+    });
+}
+
+IdleMode Renderer::GetIdleMode()
+{
+    return m_IdleMode;
+}
+
+void Renderer::Invalidate()
+{
+    m_Generation++;
+}
+
+uint64_t Renderer::GetSkippedFrames()
+{
+    return m_SkippedFrames;
+}
+
+uint64_t Renderer::GetCulledSubmissions()
+{
+    return m_CulledSubmissions;
+}
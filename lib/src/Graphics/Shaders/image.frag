@@ -8,55 +8,36 @@ layout(location = 0) in struct {
     vec4 UIRadius;
 } In;
 
+// 0: square, no corner math and no discard. 1: rounded, per-corner rounded-box SDF
+layout(constant_id = 0) const int CORNER_MODE = 1;
+
 const float smoothness = 0.7;
 
 void main()
 {
-    float alpha = In.Color.a;
-    vec4 radius = In.UIRadius;
-
-    if (alpha <= 0.0) {
-        discard; // no need to do anything else
+    // Vertex alpha is applied twice on both paths, same as before the variants existed
+    if (CORNER_MODE == 0) {
+        fColor = In.Color * texture(sTexture, In.TexCoord);
+        fColor.a *= In.Color.a;
+        return;
     }
 
-    vec2 pixelPos = In.TexCoord * In.UISize;
-
-    // Get the corner radius
-    float radiusTopLeft = In.UIRadius.x;
-    float radiusTopRight = In.UIRadius.y;
-    float radiusBottomLeft = In.UIRadius.z;
-    float radiusBottomRight = In.UIRadius.w;
+    float alpha = In.Color.a;
 
-    if (radiusTopLeft > 0.0  && alpha > 0.0) {
-        if (pixelPos.x < radiusTopLeft && pixelPos.y < radiusTopLeft) {
-            alpha *= 1.0 - smoothstep(radiusTopLeft - smoothness, radiusTopLeft + smoothness, length(pixelPos - vec2(radiusTopLeft, radiusTopLeft)));
-        }
-    }
+    // Distance to the rounded box, centered on the element. UIRadius is (top-left, top-right, bottom-left, bottom-right)
+    vec2 halfSize = In.UISize * 0.5;
+    vec2 p = In.TexCoord * In.UISize - halfSize;
 
-    if (radiusTopRight > 0.0 && alpha > 0.0) {
-        float xMax = In.UISize.x - radiusTopRight;
-        if (pixelPos.x > xMax && pixelPos.y < radiusTopRight) {
-            alpha *= 1.0 - smoothstep(radiusTopRight - smoothness, radiusTopRight + smoothness, length(pixelPos - vec2(xMax, radiusTopRight)));
-        }
-    }
+    vec2  side = mix(In.UIRadius.xz, In.UIRadius.yw, step(0.0, p.x));
+    float radius = max(mix(side.x, side.y, step(0.0, p.y)), 0.0);
 
-    if (radiusBottomLeft > 0.0 && alpha > 0.0) {
-        float yMax = In.UISize.y - radiusBottomLeft;
-        if (pixelPos.x < radiusBottomLeft && pixelPos.y > yMax) {
-            alpha *= 1.0 - smoothstep(radiusBottomLeft - smoothness, radiusBottomLeft + smoothness, length(pixelPos - vec2(radiusBottomLeft, yMax)));
-        }
-    }
+    vec2  q = abs(p) - halfSize + radius;
+    float dist = min(max(q.x, q.y), 0.0) + length(max(q, 0.0)) - radius;
 
-    if (radiusBottomRight > 0.0 && alpha > 0.0) {
-        float xMax = In.UISize.x - radiusBottomRight;
-        float yMax = In.UISize.y - radiusBottomRight;
-        if (pixelPos.x > xMax && pixelPos.y > yMax) {
-            alpha *= 1.0 - smoothstep(radiusBottomRight - smoothness, radiusBottomRight + smoothness, length(pixelPos - vec2(xMax, yMax)));
-        }
-    }
+    alpha *= 1.0 - smoothstep(-smoothness, smoothness, dist);
 
     if (alpha <= 0.0) {
-        discard; // same as above
+        discard;
     }
 
     fColor = In.Color * texture(sTexture, In.TexCoord);
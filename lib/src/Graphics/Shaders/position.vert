@@ -13,6 +13,14 @@ layout(push_constant) uniform uPushConstant
     // Same for all textures
     vec2 uScale; 
     vec2 uTranslate; 
+
+    // Per draw 2D affine transform, columns of the 2x2 matrix in uTransform
+    vec2 uPivot;
+    vec4 uTransform;
+    vec2 uOffset;
+
+    // From the submission's place in the sorted queue, nearer is smaller
+    float uDepth;
 } pc;
 
 out gl_PerVertex { vec4 gl_Position; };
@@ -27,7 +35,9 @@ layout(location = 0) out struct
 
 void main()
 {
-    gl_Position = vec4(aPosition * pc.uScale + pc.uTranslate, 0, 1);
+    vec2 position = mat2(pc.uTransform.xy, pc.uTransform.zw) * (aPosition - pc.uPivot) + pc.uPivot + pc.uOffset;
+
+    gl_Position = vec4(position * pc.uScale + pc.uTranslate, pc.uDepth, 1);
     Out.Color = aColor;
     Out.TexCoord = aTexCoord;
     Out.UIRadius = pc.uUIRadius;
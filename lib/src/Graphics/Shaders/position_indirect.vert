@@ -0,0 +1,53 @@
+#version 450 core
+
+layout(location = 0) in vec2 aPosition;
+layout(location = 1) in vec2 aTexCoord;
+layout(location = 2) in vec4 aColor;
+
+// Same for every draw of a pass
+layout(push_constant) uniform uPushConstant
+{
+    vec2 uScale;
+    vec2 uTranslate;
+} pc;
+
+// What position.vert takes from push constants, one entry per indirect command
+struct DrawParams
+{
+    vec4  UIRadius;
+    vec2  UISize;
+    vec2  Pivot;
+    vec4  Transform;
+    vec2  Offset;
+    float Depth;
+    float Padding;
+};
+
+// Each command's firstInstance is its slot in here
+layout(std430, set = 1, binding = 0) readonly buffer uDrawParams
+{
+    DrawParams draws[];
+};
+
+out gl_PerVertex { vec4 gl_Position; };
+
+layout(location = 0) out struct
+{
+    vec4 Color;
+    vec2 TexCoord;
+    vec2 UISize;
+    vec4 UIRadius;
+} Out;
+
+void main()
+{
+    DrawParams draw = draws[gl_InstanceIndex];
+
+    vec2 position = mat2(draw.Transform.xy, draw.Transform.zw) * (aPosition - draw.Pivot) + draw.Pivot + draw.Offset;
+
+    gl_Position = vec4(position * pc.uScale + pc.uTranslate, draw.Depth, 1);
+    Out.Color = aColor;
+    Out.TexCoord = aTexCoord;
+    Out.UIRadius = draw.UIRadius;
+    Out.UISize = draw.UISize;
+}
@@ -1,4 +1,5 @@
 #include <Inputs/InputManager.h>
+#include <algorithm>
 using namespace Inputs;
 
 Manager *Manager::Instance = nullptr;
@@ -7,6 +8,8 @@ Manager::Manager()
 {
     OnKeyEvent = []() {};
     OnMouseEvent = []() {};
+
+    Listeners = std::make_shared<ListenerTable>();
 }
 
 Manager::~Manager()
@@ -49,54 +52,179 @@ void Manager::Update(SDL_Event &event)
 
 void Manager::HandleKeyEvent(SDL_Event &event)
 {
-    bool previus = KeyStates[(Keys)event.key.keysym.scancode];
-
-    switch (event.type) {
-        case SDL_KEYDOWN:
-            KeyStates[(Keys)event.key.keysym.scancode] = true;
-            break;
-        case SDL_KEYUP:
-            KeyStates[(Keys)event.key.keysym.scancode] = false;
-            break;
+    size_t index = (size_t)event.key.keysym.scancode;
+    if (index >= kKeyCount) {
+        return;
     }
 
-    if (previus != KeyStates[(Keys)event.key.keysym.scancode]) {
+    auto &counter = KeyCounters[index];
+    bool  down = event.type == SDL_KEYDOWN;
+    bool  previus = counter.Presses != counter.Releases;
+
+    if (down != previus) {
+        (down ? counter.Presses : counter.Releases)++;
         OnKeyEvent();
     }
+
+    // Key repeat only matters to text input
+    if (!event.key.repeat) {
+        State state = {};
+        state.Type = down ? Type::KeyDown : Type::KeyUp;
+        state.Keyboard.Key = (Keys)index;
+        state.Keyboard.IsDown = down;
+
+        QueueEvent(state);
+
+        auto listeners = std::atomic_load(&Listeners);
+        Dispatch(listeners->KeyListeners[index], state);
+    }
 }
 
 void Manager::HandleMouseEvent(SDL_Event &event)
 {
-    bool previus = MouseStates[(Mouse)event.button.button];
-
-    switch (event.type) {
-        case SDL_MOUSEBUTTONDOWN:
-            MouseStates[(Mouse)event.button.button] = true;
-            break;
-        case SDL_MOUSEBUTTONUP:
-            MouseStates[(Mouse)event.button.button] = false;
-            break;
+    size_t index = (size_t)event.button.button;
+    if (index >= kMouseCount) {
+        return;
     }
 
-    if (previus != MouseStates[(Mouse)event.button.button]) {
+    auto &counter = MouseCounters[index];
+    bool  down = event.type == SDL_MOUSEBUTTONDOWN;
+    bool  previus = counter.Presses != counter.Releases;
+
+    if (down != previus) {
+        (down ? counter.Presses : counter.Releases)++;
         OnMouseEvent();
     }
+
+    State state = {};
+    state.Type = down ? Type::MouseDown : Type::MouseUp;
+    state.Mouse.Button = (Mouse)index;
+    state.Mouse.X = event.button.x;
+    state.Mouse.Y = event.button.y;
+    state.Mouse.IsDown = down;
+
+    QueueEvent(state);
+
+    auto listeners = std::atomic_load(&Listeners);
+    Dispatch(listeners->MouseListeners[index], state);
 }
 
 void Manager::HandleMouseMotionEvent(SDL_Event &event)
 {
     MousePosition.X = event.motion.x;
     MousePosition.Y = event.motion.y;
+
+    State state = {};
+    state.Type = Type::MouseMove;
+    state.Mouse.X = event.motion.x;
+    state.Mouse.Y = event.motion.y;
+    state.Mouse.IsDown = event.motion.state != 0;
+
+    QueueEvent(state);
+}
+
+void Manager::QueueEvent(State &event)
+{
+    if (!EventQueueEnabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    event.Timestamp = std::chrono::steady_clock::now();
+
+    if (!Events.Push(event)) {
+        DroppedEvents++;
+    }
+}
+
+void Manager::Dispatch(const std::vector<Listener> &listeners, const State &event)
+{
+    for (auto &listener : listeners) {
+        listener.Callback(event);
+    }
+}
+
+void Manager::EnableEventQueue(bool enabled)
+{
+    EventQueueEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Manager::PollEvent(State &event)
+{
+    return Events.Pop(event);
+}
+
+void Manager::DrainEvents(std::vector<State> &events)
+{
+    State event;
+    while (Events.Pop(event)) {
+        events.push_back(event);
+    }
+}
+
+uint64_t Manager::GetDroppedEvents()
+{
+    return DroppedEvents;
 }
 
 bool Manager::IsKeyDown(Keys key)
 {
-    return KeyStates[key];
+    size_t index = (size_t)key;
+    if (index >= kKeyCount) {
+        return false;
+    }
+
+    auto &counter = KeyCounters[index];
+    return counter.Presses != counter.Releases;
 }
 
 bool Manager::IsMouseDown(Mouse button)
 {
-    return MouseStates[button];
+    size_t index = (size_t)button;
+    if (index >= kMouseCount) {
+        return false;
+    }
+
+    auto &counter = MouseCounters[index];
+    return counter.Presses != counter.Releases;
+}
+
+void Manager::NewFrame()
+{
+    KeyLastFrame = KeyFrame;
+    for (size_t i = 0; i < kKeyCount; i++) {
+        KeyFrame[i].Presses = KeyCounters[i].Presses.load(std::memory_order_relaxed);
+        KeyFrame[i].Releases = KeyCounters[i].Releases.load(std::memory_order_relaxed);
+    }
+
+    MouseLastFrame = MouseFrame;
+    for (size_t i = 0; i < kMouseCount; i++) {
+        MouseFrame[i].Presses = MouseCounters[i].Presses.load(std::memory_order_relaxed);
+        MouseFrame[i].Releases = MouseCounters[i].Releases.load(std::memory_order_relaxed);
+    }
+}
+
+bool Manager::IsKeyPressed(Keys key)
+{
+    size_t index = (size_t)key;
+    return index < kKeyCount && KeyFrame[index].Presses != KeyLastFrame[index].Presses;
+}
+
+bool Manager::IsKeyReleased(Keys key)
+{
+    size_t index = (size_t)key;
+    return index < kKeyCount && KeyFrame[index].Releases != KeyLastFrame[index].Releases;
+}
+
+bool Manager::IsMousePressed(Mouse button)
+{
+    size_t index = (size_t)button;
+    return index < kMouseCount && MouseFrame[index].Presses != MouseLastFrame[index].Presses;
+}
+
+bool Manager::IsMouseReleased(Mouse button)
+{
+    size_t index = (size_t)button;
+    return index < kMouseCount && MouseFrame[index].Releases != MouseLastFrame[index].Releases;
 }
 
 void Manager::ListenOnKeyEvent(std::function<void()> callback)
@@ -107,4 +235,59 @@ void Manager::ListenOnKeyEvent(std::function<void()> callback)
 void Manager::ListenOnMouseEvent(std::function<void()> callback)
 {
     OnMouseEvent = callback;
+}
+
+uint32_t Manager::AddKeyListener(Keys key, std::function<void(const State &)> callback)
+{
+    size_t index = (size_t)key;
+    if (index >= kKeyCount) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(ListenerMutex);
+
+    auto table = std::make_shared<ListenerTable>(*Listeners);
+    table->KeyListeners[index].push_back({ ++ListenerId, callback });
+
+    std::atomic_store(&Listeners, std::shared_ptr<const ListenerTable>(table));
+    return ListenerId;
+}
+
+uint32_t Manager::AddMouseListener(Mouse button, std::function<void(const State &)> callback)
+{
+    size_t index = (size_t)button;
+    if (index >= kMouseCount) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(ListenerMutex);
+
+    auto table = std::make_shared<ListenerTable>(*Listeners);
+    table->MouseListeners[index].push_back({ ++ListenerId, callback });
+
+    std::atomic_store(&Listeners, std::shared_ptr<const ListenerTable>(table));
+    return ListenerId;
+}
+
+void Manager::RemoveListener(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(ListenerMutex);
+
+    auto table = std::make_shared<ListenerTable>(*Listeners);
+    auto remove = [id](std::vector<Listener> &listeners) {
+        listeners.erase(std::remove_if(listeners.begin(), listeners.end(), [id](const Listener &listener) {
+                            return listener.Id == id;
+                        }),
+                        listeners.end());
+    };
+
+    for (auto &listeners : table->KeyListeners) {
+        remove(listeners);
+    }
+
+    for (auto &listeners : table->MouseListeners) {
+        remove(listeners);
+    }
+
+    std::atomic_store(&Listeners, std::shared_ptr<const ListenerTable>(table));
 }
\ No newline at end of file
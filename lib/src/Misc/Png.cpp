@@ -0,0 +1,113 @@
+#include <Exceptions/EstException.h>
+#include <Misc/Png.h>
+#include <algorithm>
+#include <fstream>
+using namespace Misc;
+
+namespace {
+    uint32_t Crc32(const uint8_t *data, size_t size, uint32_t crc = 0)
+    {
+        static uint32_t table[256] = {};
+        if (table[1] == 0) {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+
+                table[i] = c;
+            }
+        }
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return ~crc;
+    }
+
+    void PutU32(std::vector<uint8_t> &out, uint32_t value)
+    {
+        out.push_back((uint8_t)(value >> 24));
+        out.push_back((uint8_t)(value >> 16));
+        out.push_back((uint8_t)(value >> 8));
+        out.push_back((uint8_t)value);
+    }
+
+    void PutChunk(std::ofstream &fs, const char *type, const std::vector<uint8_t> &data)
+    {
+        std::vector<uint8_t> chunk;
+        PutU32(chunk, (uint32_t)data.size());
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        PutU32(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+
+        fs.write((const char *)chunk.data(), chunk.size());
+    }
+}
+
+void Png::Write(std::filesystem::path path, const std::vector<uint8_t> &pixels, int width, int height)
+{
+    size_t stride = (size_t)width * 4;
+    if (width <= 0 || height <= 0 || pixels.size() < stride * height) {
+        throw Exceptions::EstException("Invalid image size for " + path.string());
+    }
+
+    std::ofstream fs(path, std::ios::out | std::ios::binary);
+    if (!fs.is_open()) {
+        throw Exceptions::EstException("Failed to open file: " + path.string());
+    }
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fs.write((const char *)signature, sizeof(signature));
+
+    std::vector<uint8_t> header;
+    PutU32(header, (uint32_t)width);
+    PutU32(header, (uint32_t)height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8-bit RGBA, deflate, no filter method extras, no interlace
+    PutChunk(fs, "IHDR", header);
+
+    // Each scanline is prefixed with filter type 0
+    std::vector<uint8_t> raw;
+    raw.reserve((stride + 1) * height);
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * stride, pixels.begin() + (y + 1) * stride);
+    }
+
+    // zlib stream made of stored deflate blocks
+    std::vector<uint8_t> data = { 0x78, 0x01 };
+    data.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+
+    uint32_t a = 1, b = 0;
+    size_t   offset = 0;
+    do {
+        size_t size = std::min<size_t>(raw.size() - offset, 65535);
+        bool   last = offset + size == raw.size();
+
+        data.push_back(last ? 1 : 0);
+        data.push_back((uint8_t)size);
+        data.push_back((uint8_t)(size >> 8));
+        data.push_back((uint8_t)~size);
+        data.push_back((uint8_t)(~size >> 8));
+
+        for (size_t i = 0; i < size; i++) {
+            uint8_t value = raw[offset + i];
+            data.push_back(value);
+
+            a = (a + value) % 65521;
+            b = (b + a) % 65521;
+        }
+
+        offset += size;
+    } while (offset < raw.size());
+
+    PutU32(data, (b << 16) | a);
+    PutChunk(fs, "IDAT", data);
+    PutChunk(fs, "IEND", {});
+
+    if (!fs.good()) {
+        throw Exceptions::EstException("Failed to write file: " + path.string());
+    }
+}
@@ -0,0 +1,373 @@
+#include <Threads/JobSystem.h>
+#include <Threads/ThreadOptions.h>
+#include <algorithm>
+#include <deque>
+#include <string>
+
+namespace {
+    // Worker running on this thread, -1 on any other thread
+    thread_local int t_Worker = -1;
+
+    // Without workers, jobs made runnable while this thread runs one inline wait here instead of recursing
+    thread_local std::deque<JobSystem::JobHandle> *t_Inline = nullptr;
+
+    // Render, input and audio threads keep a core busy each
+    const uint32_t kReservedThreads = 3;
+} // namespace
+
+JobSystem *JobSystem::s_Instance = nullptr;
+
+JobSystem::JobSystem()
+{
+}
+
+JobSystem::~JobSystem()
+{
+    Stop();
+}
+
+JobSystem *JobSystem::Get()
+{
+    if (s_Instance == nullptr) {
+        s_Instance = new JobSystem;
+    }
+
+    return s_Instance;
+}
+
+void JobSystem::Destroy()
+{
+    if (s_Instance != nullptr) {
+        delete s_Instance;
+        s_Instance = nullptr;
+    }
+}
+
+void JobSystem::Start(uint32_t threads)
+{
+    if (m_Running) {
+        return;
+    }
+
+    if (threads == 0) {
+        uint32_t cores = std::thread::hardware_concurrency();
+        threads = cores > kReservedThreads + 1 ? cores - kReservedThreads : 1;
+    }
+
+    for (uint32_t i = 0; i < threads; i++) {
+        m_Queues.push_back(std::make_unique<Queue>());
+    }
+
+    m_Running = true;
+    for (uint32_t i = 0; i < threads; i++) {
+        m_Workers.emplace_back([this, i]() { WorkerLoop((int)i); });
+    }
+}
+
+void JobSystem::Stop()
+{
+    if (!m_Running) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Running = false;
+    }
+
+    m_SleepCondition.notify_all();
+
+    for (auto &worker : m_Workers) {
+        worker.join();
+    }
+
+    m_Workers.clear();
+
+    // Whatever is left runs here, nothing waiting on it may hang
+    while (auto job = Find(-1)) {
+        Execute(job);
+    }
+
+    m_Queues.clear();
+}
+
+uint32_t JobSystem::GetThreads()
+{
+    return (uint32_t)m_Workers.size();
+}
+
+JobSystem::JobHandle JobSystem::Submit(std::function<void()> function, const std::vector<JobHandle> &dependencies)
+{
+    auto job = std::make_shared<Job>();
+    job->function = std::move(function);
+
+    // done is set under the same mutex, a dependency either takes the continuation or is already finished
+    for (auto &dependency : dependencies) {
+        if (!dependency) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->done) {
+            job->pending++;
+            dependency->continuations.push_back(job);
+        }
+    }
+
+    Release(job);
+    return job;
+}
+
+JobSystem::JobHandle JobSystem::Then(JobHandle job, std::function<void()> function)
+{
+    return Submit(std::move(function), { job });
+}
+
+void JobSystem::Wait(JobHandle job)
+{
+    if (!job) {
+        return;
+    }
+
+    while (!job->done) {
+        if (t_Inline && !t_Inline->empty()) {
+            auto next = std::move(t_Inline->front());
+            t_Inline->pop_front();
+
+            Execute(next);
+            continue;
+        }
+
+        if (auto next = Find(t_Worker)) {
+            Execute(next);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_WaitMutex);
+        m_Waiters++;
+        m_WaitCondition.wait(lock, [&]() { return job->done || m_Queued > 0; });
+        m_Waiters--;
+    }
+
+    if (job->error) {
+        std::rethrow_exception(job->error);
+    }
+}
+
+void JobSystem::Wait(const std::vector<JobHandle> &jobs)
+{
+    for (auto &job : jobs) {
+        Wait(job);
+    }
+}
+
+bool JobSystem::IsDone(JobHandle job)
+{
+    return !job || job->done;
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, std::function<void(size_t begin, size_t end)> function)
+{
+    if (count == 0) {
+        return;
+    }
+
+    grain = std::max<size_t>(grain, 1);
+
+    size_t chunks = (count + grain - 1) / grain;
+    size_t helpers = std::min(chunks, m_Workers.size() + 1) - 1;
+    if (helpers == 0) {
+        function(0, count);
+        return;
+    }
+
+    // Chunks are handed out on demand, a slow chunk doesn't hold up a fixed share of the rest
+    std::atomic<size_t> next{ 0 };
+    auto                run = [&]() {
+        size_t chunk;
+        while ((chunk = next++) < chunks) {
+            size_t begin = chunk * grain;
+            function(begin, std::min(begin + grain, count));
+        }
+    };
+
+    std::vector<JobHandle> jobs;
+    for (size_t i = 0; i < helpers; i++) {
+        jobs.push_back(Submit(run));
+    }
+
+    std::exception_ptr error;
+    try {
+        run();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    // Every helper references this frame, all of them have to finish before anything is rethrown
+    for (auto &job : jobs) {
+        try {
+            Wait(job);
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::Release(JobHandle job)
+{
+    if (--job->pending == 0) {
+        Schedule(job);
+    }
+}
+
+void JobSystem::Schedule(JobHandle job)
+{
+    // A long chain of continuations runs as a loop, not as nested calls
+    if (!m_Running) {
+        if (t_Inline) {
+            t_Inline->push_back(std::move(job));
+            return;
+        }
+
+        std::deque<JobHandle> pending;
+        pending.push_back(std::move(job));
+
+        t_Inline = &pending;
+        while (!pending.empty()) {
+            auto next = std::move(pending.front());
+            pending.pop_front();
+
+            Execute(next);
+        }
+
+        t_Inline = nullptr;
+        return;
+    }
+
+    // Workers keep what they spawn, LIFO keeps its data in cache
+    // Counted under the queue's mutex like the pop in Find, the count can't drop below the jobs it was given
+    Queue &queue = t_Worker >= 0 ? *m_Queues[t_Worker] : m_Shared;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+        m_Queued++;
+    }
+
+    // A worker going to sleep counts itself before re-checking m_Queued under the mutex,
+    // so either it sees this job or it is counted here and taking the mutex orders the notify after its check
+    if (m_Sleeping > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_SleepMutex);
+        }
+
+        m_SleepCondition.notify_one();
+    }
+}
+
+void JobSystem::Execute(JobHandle job)
+{
+    try {
+        job->function();
+    } catch (...) {
+        job->error = std::current_exception();
+    }
+
+    job->function = nullptr;
+
+    // Continuations run whether or not the job threw, Wait on the job itself reports the error
+    std::vector<JobHandle> continuations;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done = true;
+        continuations.swap(job->continuations);
+    }
+
+    for (auto &continuation : continuations) {
+        Release(continuation);
+    }
+
+    if (m_Waiters > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_WaitMutex);
+        }
+
+        m_WaitCondition.notify_all();
+    }
+}
+
+JobSystem::JobHandle JobSystem::Find(int worker)
+{
+    if (m_Queued == 0) {
+        return nullptr;
+    }
+
+    auto pop = [&](Queue &queue, bool back) -> JobHandle {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) {
+            return nullptr;
+        }
+
+        JobHandle job;
+        if (back) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+
+        m_Queued--;
+        return job;
+    };
+
+    if (worker >= 0) {
+        if (auto job = pop(*m_Queues[worker], true)) {
+            return job;
+        }
+    }
+
+    if (auto job = pop(m_Shared, false)) {
+        return job;
+    }
+
+    // Steal the oldest job, starting at the next worker so thieves spread out
+    size_t count = m_Queues.size();
+    for (size_t i = 1; i <= count; i++) {
+        size_t victim = (size_t)(worker + i) % count;
+        if ((int)victim == worker) {
+            continue;
+        }
+
+        if (auto job = pop(*m_Queues[victim], false)) {
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::WorkerLoop(int worker)
+{
+    t_Worker = worker;
+    ApplyThreadOptions({ "est-job-" + std::to_string(worker) });
+
+    while (m_Running) {
+        if (auto job = Find(worker)) {
+            Execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_Sleeping++;
+        m_SleepCondition.wait(lock, [&]() { return m_Queued > 0 || !m_Running; });
+        m_Sleeping--;
+    }
+
+    t_Worker = -1;
+}
@@ -33,6 +33,9 @@ void Thread::Start()
     m_Running = true;
 
     m_Thread = std::thread([&]() {
+        m_Id = std::this_thread::get_id();
+        ApplyThreadOptions(m_Options);
+
         m_ThreadPreFunction();
 
         while (m_Running) {
@@ -46,12 +49,21 @@ void Thread::Start()
 void Thread::Stop()
 {
     m_Running = false;
-    m_Thread.join();
+
+    // Also called on error paths, before the thread was started or after it was already stopped
+    if (m_Thread.joinable()) {
+        m_Thread.join();
+    }
 }
 
 void Thread::Tick()
 {
-    m_Id = std::this_thread::get_id();
+    // Ticked from outside, the ticking thread takes the options
+    auto id = std::this_thread::get_id();
+    if (id != m_Id) {
+        m_Id = id;
+        ApplyThreadOptions(m_Options);
+    }
     double dt = m_TimeWatch.Tick();
 
     m_ThreadFunction(dt);
@@ -65,11 +77,26 @@ void Thread::SetTickRate(double tickRate)
     m_TimeWatch.SetTickRate(tickRate);
 }
 
+void Thread::SetSkipMissed(bool skip)
+{
+    m_TimeWatch.SetSkipMissed(skip);
+}
+
+void Thread::SetOptions(ThreadOptions options)
+{
+    m_Options = options;
+}
+
 std::thread::id Thread::GetId()
 {
     return m_Id;
 }
 
+TimeWatch::Jitter Thread::GetJitter()
+{
+    return m_TimeWatch.GetJitter();
+}
+
 void Thread::AddCallback(std::function<void(void)> callback)
 {
     m_Callback.push_back(callback);
@@ -0,0 +1,84 @@
+#include <Threads/ThreadOptions.h>
+#include <algorithm>
+
+#if _WIN32
+#include <windows.h>
+#elif __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if _WIN32
+bool ApplyThreadOptions(const ThreadOptions &options)
+{
+    bool   applied = true;
+    HANDLE thread = GetCurrentThread();
+
+    if (!options.name.empty()) {
+        std::wstring name(options.name.begin(), options.name.end());
+        applied &= SUCCEEDED(SetThreadDescription(thread, name.c_str()));
+    }
+
+    if (options.affinity) {
+        applied &= SetThreadAffinityMask(thread, (DWORD_PTR)options.affinity) != 0;
+    }
+
+    int priority = THREAD_PRIORITY_NORMAL;
+    if (options.realtimePriority > 0) {
+        priority = THREAD_PRIORITY_TIME_CRITICAL;
+    } else if (options.nice < 0) {
+        priority = options.nice <= -10 ? THREAD_PRIORITY_HIGHEST : THREAD_PRIORITY_ABOVE_NORMAL;
+    } else if (options.nice > 0) {
+        priority = options.nice >= 10 ? THREAD_PRIORITY_LOWEST : THREAD_PRIORITY_BELOW_NORMAL;
+    }
+
+    if (priority != THREAD_PRIORITY_NORMAL) {
+        applied &= SetThreadPriority(thread, priority) != 0;
+    }
+
+    return applied;
+}
+#elif __linux__
+bool ApplyThreadOptions(const ThreadOptions &options)
+{
+    bool      applied = true;
+    pthread_t thread = pthread_self();
+
+    if (!options.name.empty()) {
+        applied &= pthread_setname_np(thread, options.name.substr(0, 15).c_str()) == 0;
+    }
+
+    if (options.affinity) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+
+        for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; cpu++) {
+            if (options.affinity & (1ull << cpu)) {
+                CPU_SET(cpu, &set);
+            }
+        }
+
+        applied &= pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+    }
+
+    if (options.realtimePriority > 0) {
+        sched_param param = {};
+        param.sched_priority = std::min(options.realtimePriority, sched_get_priority_max(SCHED_FIFO));
+
+        applied &= pthread_setschedparam(thread, SCHED_FIFO, &param) == 0;
+    } else if (options.nice != 0) {
+        // Linux applies nice per thread when given a thread id
+        applied &= setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), options.nice) == 0;
+    }
+
+    return applied;
+}
+#else
+bool ApplyThreadOptions(const ThreadOptions &options)
+{
+    return options.name.empty() && !options.affinity && !options.realtimePriority && !options.nice;
+}
+#endif
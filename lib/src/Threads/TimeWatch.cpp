@@ -1,11 +1,25 @@
 #include <Threads/TimeWatch.h>
-#define SDL_MAIN_HANDLED
-#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+    // Sleeps overshoot by up to a timer period, the last stretch before a deadline is spent yielding
+    // The stretch follows the overshoot measured recently, within these bounds and a share of the interval
+    const auto kMinSpinWindow = std::chrono::microseconds(50);
+    const auto kMaxSpinWindow = std::chrono::microseconds(2000);
+    const int  kMaxSpinShare = 4;
+
+    // Further behind than this, the missed deadlines are dropped instead of ticking back to back to catch up
+    const auto kMaxLag = std::chrono::milliseconds(30);
+} // namespace
 
 TimeWatch::TimeWatch()
 {
-    m_LastTick = static_cast<double>(SDL_GetTicks64());
-    m_CurTick = m_LastTick;
+    m_LastTick = Clock::now();
+    m_Deadline = m_LastTick;
+
+    m_Samples.reserve(kJitterSamples);
 }
 
 TimeWatch::~TimeWatch()
@@ -14,24 +28,104 @@ TimeWatch::~TimeWatch()
 
 double TimeWatch::Tick()
 {
-    double newTick = static_cast<double>(SDL_GetTicks64());
-    double delta = 1000.0 / m_TickRate - (newTick - m_LastTick);
-
-    if (delta > 0) {
-        int delayTicks = static_cast<int>(delta);
-        SDL_Delay(delayTicks);
-        newTick += delayTicks;
-        delta -= delayTicks;
+    auto now = Clock::now();
+
+    if (m_Interval > Clock::duration::zero()) {
+        WaitUntil(m_Deadline);
+        now = Clock::now();
+
+        if (m_SkipMissed && now - m_Deadline >= m_Interval) {
+            auto missed = (now - m_Deadline) / m_Interval;
+
+            m_Deadline += missed * m_Interval;
+            m_Skipped += (uint64_t)missed;
+        }
+
+        if (now - m_Deadline > kMaxLag) {
+            // A stall rather than jitter, it shows up in the returned delta instead
+            m_Deadline = now + m_Interval;
+        } else {
+            float error = std::chrono::duration<float, std::milli>(now - m_Deadline).count();
+            if (m_Samples.size() < kJitterSamples) {
+                m_Samples.push_back(error);
+            } else {
+                m_Samples[m_SampleIndex] = error;
+            }
+
+            m_SampleIndex = (m_SampleIndex + 1) % kJitterSamples;
+            m_Ticks++;
+
+            m_Deadline += m_Interval;
+        }
     }
 
-    double dt = (newTick - m_CurTick) / 1000.0;
-    m_LastTick = (delta < -30.0) ? newTick : newTick + delta;
-    m_CurTick = newTick;
+    double dt = std::chrono::duration<double>(now - m_LastTick).count();
+    m_LastTick = now;
 
     return dt;
 }
 
+void TimeWatch::WaitUntil(Clock::time_point deadline)
+{
+    auto spin = std::min<Clock::duration>(m_SpinWindow, m_Interval / kMaxSpinShare);
+
+    auto now = Clock::now();
+    if (deadline - now > spin) {
+        auto wake = deadline - spin;
+        std::this_thread::sleep_until(wake);
+
+        // Decaying maximum, a single late wakeup widens the window for a while
+        auto overshoot = Clock::now() - wake;
+        m_SpinWindow = std::clamp<Clock::duration>(std::max<Clock::duration>(overshoot, m_SpinWindow * 63 / 64), kMinSpinWindow, kMaxSpinWindow);
+    }
+
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void TimeWatch::SetSkipMissed(bool skip)
+{
+    m_SkipMissed = skip;
+}
+
 void TimeWatch::SetTickRate(double tickRate)
 {
-    m_TickRate = tickRate;
-}
\ No newline at end of file
+    auto interval = tickRate > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickRate)) : Clock::duration::zero();
+
+    // Re-anchor so a rate change doesn't inherit the old schedule
+    if (interval != m_Interval) {
+        m_Interval = interval;
+        m_Deadline = Clock::now() + m_Interval;
+    }
+}
+
+TimeWatch::Jitter TimeWatch::GetJitter()
+{
+    Jitter jitter;
+    jitter.ticks = m_Ticks;
+    jitter.skipped = m_Skipped;
+
+    if (m_Samples.empty()) {
+        return jitter;
+    }
+
+    std::vector<float> errors(m_Samples.size());
+    std::transform(m_Samples.begin(), m_Samples.end(), errors.begin(), [](float error) {
+        return std::abs(error);
+    });
+
+    double sum = 0.0;
+    for (float error : errors) {
+        sum += error;
+    }
+
+    size_t p99 = (errors.size() * 99) / 100;
+    std::nth_element(errors.begin(), errors.begin() + p99, errors.end());
+
+    jitter.mean = sum / errors.size();
+    jitter.p99 = errors[p99];
+    jitter.max = *std::max_element(errors.begin(), errors.end());
+
+    return jitter;
+}
@@ -0,0 +1,124 @@
+#include <Exceptions/EstException.h>
+#include <Graphics/Renderer.h>
+#include <UI/Layer.h>
+#include <algorithm>
+#include <cmath>
+using namespace UI;
+using namespace Graphics;
+
+namespace {
+    // Lets the layer quad go through the regular image path
+    class RenderTargetTexture : public Texture2D
+    {
+    public:
+        RenderTargetTexture(Backends::RenderTargetHandle *handle) : m_handle(handle) {}
+
+        void Load(std::filesystem::path) override { throw Exceptions::EstException("Render target texture cannot be loaded"); }
+        void Load(const char *, size_t) override { throw Exceptions::EstException("Render target texture cannot be loaded"); }
+        void Load(const char *, uint32_t, uint32_t) override { throw Exceptions::EstException("Render target texture cannot be loaded"); }
+
+        const void *GetId() override
+        {
+            return Renderer::Get()->GetRenderTargetImage(*m_handle);
+        }
+
+    private:
+        Backends::RenderTargetHandle *m_handle;
+    };
+} // namespace
+
+Layer::Layer()
+{
+    m_target = Backends::kBackbuffer;
+    m_targetRect = {};
+    m_dirty = true;
+
+    // DefaultBlend::BLEND leaves premultiplied colors in the transparent target
+    BlendState = Backends::DefaultBlend::PREMULTIPLIED;
+
+    m_texture = std::make_unique<RenderTargetTexture>(&m_target);
+}
+
+Layer::~Layer()
+{
+    for (auto child : m_children) {
+        child->Parent = nullptr;
+    }
+
+    if (m_target != Backends::kBackbuffer) {
+        Renderer::Get()->DestroyRenderTarget(m_target);
+    }
+}
+
+void Layer::Add(Base *child)
+{
+    if (std::find(m_children.begin(), m_children.end(), child) != m_children.end()) {
+        return;
+    }
+
+    child->Parent = this;
+    m_children.push_back(child);
+    m_dirty = true;
+}
+
+void Layer::Remove(Base *child)
+{
+    auto it = std::find(m_children.begin(), m_children.end(), child);
+    if (it == m_children.end()) {
+        return;
+    }
+
+    child->Parent = nullptr;
+    m_children.erase(it);
+    m_dirty = true;
+}
+
+void Layer::MarkDirty()
+{
+    m_dirty = true;
+    Base::MarkDirty();
+}
+
+void Layer::OnDraw()
+{
+    auto renderer = Renderer::Get();
+    CalculateSize();
+
+    Rect rect = {
+        (int)std::floor(AbsolutePosition.X),
+        (int)std::floor(AbsolutePosition.Y),
+        std::max((int)std::ceil(AbsoluteSize.X), 1),
+        std::max((int)std::ceil(AbsoluteSize.Y), 1)
+    };
+
+    // Children move along with the layer, only a new size needs a new target
+    if (m_target == Backends::kBackbuffer || rect.Width != m_targetRect.Width || rect.Height != m_targetRect.Height) {
+        if (m_target != Backends::kBackbuffer) {
+            renderer->DestroyRenderTarget(m_target);
+        }
+
+        m_target = renderer->CreateRenderTarget({ 0, 0, rect.Width, rect.Height });
+        m_targetRect = rect;
+        m_dirty = true;
+    }
+
+    if (m_dirty) {
+        auto previous = renderer->GetRenderTarget();
+        auto previousOrigin = renderer->GetRenderTargetOrigin();
+        renderer->SetRenderTarget(m_target, glm::vec2((float)rect.X, (float)rect.Y));
+
+        for (auto child : m_children) {
+            child->Draw(rect);
+        }
+
+        renderer->SetRenderTarget(previous, previousOrigin);
+        m_dirty = false;
+    }
+
+    Image::OnDraw();
+
+    // Premultiplied like the target, so Transparency fades the colors along with the coverage
+    for (auto &vertex : m_vertices) {
+        vertex.SetColorFloat({ Color3.R * Transparency, Color3.G * Transparency, Color3.B * Transparency, Transparency });
+    }
+}
@@ -182,6 +182,9 @@ void Text::OnDraw()
     float    scale = (m_FontAtlas->FontSize * Scale) / m_FontAtlas->FontSize;
 
     m_indices = { 0, 1, 2, 3, 4, 5 };
+    m_TextBounds = glm::vec4((float)x1, (float)y1, (float)x1, (float)y1);
+
+    bool firstGlyph = true;
 
     auto strings = split(m_TextToDraw, '\n');
     for (auto &string : strings) {
@@ -239,6 +242,17 @@ void Text::OnDraw()
                 { { _x2, _y1 }, uv2, col },
             };
 
+            if (firstGlyph) {
+                m_TextBounds = glm::vec4(_x1, _y1, _x2, _y2);
+                firstGlyph = false;
+            } else {
+                m_TextBounds = glm::vec4(
+                    std::min(m_TextBounds.x, _x1),
+                    std::min(m_TextBounds.y, _y1),
+                    std::max(m_TextBounds.z, _x2),
+                    std::max(m_TextBounds.w, _y2));
+            }
+
             pos += glyph->Advance * scale;
             InsertToBatch();
         }
@@ -247,6 +261,13 @@ void Text::OnDraw()
     }
 }
 
+glm::vec2 Text::GetPivot()
+{
+    return glm::vec2(
+        (m_TextBounds.x + m_TextBounds.z) * 0.5f,
+        (m_TextBounds.y + m_TextBounds.w) * 0.5f);
+}
+
 glm::vec2 Text::MeasureString(std::string text)
 {
     float width = 0.0f;
@@ -54,23 +54,105 @@ float CalculatePixelSize(float alpha, const glm::vec2 &rectSize)
     return pixelSize;
 }
 
+// SDL is only asked once per frame, every element of the frame shares the answer
+static Rect GetWindowRect(uint64_t frame)
+{
+    static uint64_t s_frame = UINT64_MAX;
+    static Rect     s_rect = {};
+
+    if (s_frame != frame) {
+        s_frame = frame;
+        s_rect = Graphics::NativeWindow::Get()->GetWindowSize();
+    }
+
+    return s_rect;
+}
+
+Base *Base::GetLayoutParent()
+{
+    return Parent != this ? Parent : nullptr;
+}
+
 void Base::CalculateSize()
 {
-    auto   windowRect = Graphics::NativeWindow::Get()->GetWindowSize();
-    double Width = windowRect.Width;
-    double Height = windowRect.Height;
-    double X = 0;
-    double Y = 0;
+    uint64_t frame = Graphics::Renderer::Get()->GetFrameIndex();
+
+    // Ancestors not resolved this frame are linked top-down through m_layoutNext, stamping them as they are
+    // linked also ends the walk on a cycle. The first stamped one is compared again, it may have moved since
+    Base *stop = nullptr;
+    Base *next = this;
+    for (Base *node = GetLayoutParent(); node != nullptr; node = node->GetLayoutParent()) {
+        if (node->m_layoutFrame == frame) {
+            stop = node;
+            break;
+        }
 
-    if (Parent != nullptr && Parent != this) {
-        Parent->CalculateSize();
+        node->m_layoutFrame = frame;
+        node->m_layoutNext = next;
+        next = node;
+    }
+
+    if (stop != nullptr) {
+        stop->ResolveLayout(frame);
+    }
+
+    for (Base *node = next; node != this; node = node->m_layoutNext) {
+        node->ResolveLayout(frame);
+    }
+
+    ResolveLayout(frame);
+}
+
+void Base::InvalidateLayout()
+{
+    m_layoutValid = false;
+}
+
+void Base::ResolveLayout(uint64_t frame)
+{
+    m_layoutFrame = frame;
+
+    double   Width, Height, X, Y;
+    uint64_t parentGeneration = 0;
+    bool     root = true;
+
+    Base *parent = GetLayoutParent();
+    if (parent != nullptr) {
+        Width = parent->AbsoluteSize.X;
+        Height = parent->AbsoluteSize.Y;
+        X = parent->AbsolutePosition.X;
+        Y = parent->AbsolutePosition.Y;
+
+        parentGeneration = parent->m_layoutGeneration;
+        root = false;
+    } else {
+        auto windowRect = GetWindowRect(frame);
+        Width = windowRect.Width;
+        Height = windowRect.Height;
+        X = 0;
+        Y = 0;
+    }
 
-        Width = Parent->AbsoluteSize.X;
-        Height = Parent->AbsoluteSize.Y;
-        X = Parent->AbsolutePosition.X;
-        Y = Parent->AbsolutePosition.Y;
+    // The parent's rect is covered by its generation, the window's is compared directly
+    double inputs[kLayoutInputs] = {
+        Position.X.Scale, Position.X.Offset, Position.Y.Scale, Position.Y.Offset,
+        Size.X.Scale, Size.X.Offset, Size.Y.Scale, Size.Y.Offset,
+        AnchorPoint.X, AnchorPoint.Y,
+        CornerRadius.XY.X, CornerRadius.XY.Y, CornerRadius.ZW.X, CornerRadius.ZW.Y,
+        root ? Width : 0.0, root ? Height : 0.0
+    };
+
+    if (m_layoutValid && m_layoutParent == parent && m_layoutParentGeneration == parentGeneration &&
+        std::equal(inputs, inputs + kLayoutInputs, m_layoutInputs)) {
+        return;
     }
 
+    std::copy(inputs, inputs + kLayoutInputs, m_layoutInputs);
+    m_layoutParent = parent;
+    m_layoutParentGeneration = parentGeneration;
+    m_layoutValid = true;
+    m_layoutGeneration++;
+
     double x0 = Width * Position.X.Scale + Position.X.Offset;
     double y0 = Height * Position.Y.Scale + Position.Y.Offset;
 
@@ -112,19 +194,21 @@ void Base::DrawVertices()
 
         if (m_texturePtr != nullptr) {
             info.image = m_texturePtr->GetId();
+            info.opaqueImage = m_texturePtr->IsOpaque();
         } else if (m_texture) {
             info.image = m_texture->GetId();
+            info.opaqueImage = m_texture->IsOpaque();
         }
 
-        RotateVertex();
+        ApplyTransform(info);
         renderer->Push(info);
     } else {
         if (!m_batches.size()) {
             InsertToBatch();
         }
 
-        RotateVertex();
         for (auto &batch : m_batches) {
+            ApplyTransform(batch);
             renderer->Push(batch);
         }
     }
@@ -152,72 +236,43 @@ void Base::InsertToBatch()
 
     if (m_texturePtr != nullptr) {
         info.image = m_texturePtr->GetId();
+        info.opaqueImage = m_texturePtr->IsOpaque();
     } else if (m_texture) {
         info.image = m_texture->GetId();
+        info.opaqueImage = m_texture->IsOpaque();
     }
 
     m_batches.push_back(info);
 }
 
-inline glm::vec2 computeCenter(std::vector<Graphics::Backends::Vertex> &vertices)
-{
-    glm::vec2 sum(0.0f, 0.0f);
-    int       count = 0;
-
-    for (const auto &vertex : vertices) {
-        sum += vertex.pos;
-        count++;
-    }
-
-    return sum / static_cast<float>(count);
-}
-
-inline glm::vec2 computeCenter(const std::vector<Graphics::Backends::SubmitInfo> &batches)
-{
-    glm::vec2 sum(0.0f, 0.0f);
-    int       count = 0;
-
-    for (const auto &batch : batches) {
-        for (const auto &vertex : batch.vertices) {
-            sum += vertex.pos;
-            count++;
-        }
-    }
-
-    return sum / static_cast<float>(count);
-}
-
-inline glm::vec2 rotate(glm::vec2 &vec, float cos, float sin)
+glm::vec2 Base::GetPivot()
 {
-    return { vec.x * cos - vec.y * sin, vec.x * sin + vec.y * cos };
+    return glm::vec2(
+        AbsolutePosition.X + AbsoluteSize.X * 0.5,
+        AbsolutePosition.Y + AbsoluteSize.Y * 0.5);
 }
 
-void Base::RotateVertex()
+void Base::ApplyTransform(Graphics::Backends::SubmitInfo &info)
 {
-    if (!m_vertices.size()) {
-        throw Exceptions::EstException("Vertex array is empty");
+    // Batches persist across frames, an earlier rotation is cleared rather than kept
+    if (Rotation == 0) {
+        info.transform = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+        info.pivot = glm::vec2(0.0f);
+        return;
     }
 
     float radians = glm::radians(Rotation);
     float cosAngle = glm::cos(radians);
     float sinAngle = glm::sin(radians);
 
-    if (m_renderMode == RenderMode::Normal) {
-        auto center = computeCenter(m_vertices);
-        center = rotate(center, cosAngle, sinAngle) - center;
-
-        for (auto &vertex : m_vertices) {
-            vertex.pos = rotate(vertex.pos, cosAngle, sinAngle) - center;
-        }
-    } else {
-        auto center = computeCenter(m_batches);
-        center = rotate(center, cosAngle, sinAngle) - center;
+    info.transform = glm::vec4(cosAngle, sinAngle, -sinAngle, cosAngle);
+    info.pivot = GetPivot();
+}
 
-        for (auto &info : m_batches) {
-            for (auto &vertices : info.vertices) {
-                vertices.pos = rotate(vertices.pos, cosAngle, sinAngle) - center;
-            }
-        }
+void Base::MarkDirty()
+{
+    if (Parent != nullptr && Parent != this) {
+        Parent->MarkDirty();
     }
 }
 
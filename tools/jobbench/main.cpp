@@ -0,0 +1,109 @@
+#include <Threads/JobSystem.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+    Task throughput of the JobSystem
+
+    JobBenchmark [threads]
+*/
+
+using Clock = std::chrono::steady_clock;
+
+static double Seconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void Report(const char *name, size_t jobs, double seconds)
+{
+    printf("%-28s %10zu jobs %10.3f ms %12.0f jobs/s\n", name, jobs, seconds * 1000.0, jobs / seconds);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t threads = argc > 1 ? (uint32_t)atoi(argv[1]) : 0;
+
+    auto jobs = JobSystem::Get();
+    jobs->Start(threads);
+
+    printf("%u workers\n", jobs->GetThreads());
+
+    const size_t      kJobs = 200000;
+    std::atomic<long> counter{ 0 };
+
+    {
+        // Every job goes through the shared queue
+        auto                              start = Clock::now();
+        std::vector<JobSystem::JobHandle> handles;
+        handles.reserve(kJobs);
+
+        for (size_t i = 0; i < kJobs; i++) {
+            handles.push_back(jobs->Submit([&]() { counter++; }));
+        }
+
+        jobs->Wait(handles);
+        Report("submit from outside", kJobs, Seconds(start));
+    }
+
+    {
+        // Workers fill their own deques, the rest of them steal
+        auto start = Clock::now();
+        auto root = jobs->Submit([&]() {
+            for (size_t i = 0; i < kJobs; i++) {
+                jobs->Submit([&]() { counter++; });
+            }
+        });
+
+        jobs->Wait(root);
+        while (counter < (long)kJobs * 2) {
+            std::this_thread::yield();
+        }
+
+        Report("spawn from a worker", kJobs, Seconds(start));
+    }
+
+    {
+        // Every job waits for the previous one, the cost of a continuation
+        const size_t kChain = 20000;
+
+        auto                 start = Clock::now();
+        JobSystem::JobHandle last = jobs->Submit([]() {});
+        for (size_t i = 0; i < kChain; i++) {
+            last = jobs->Then(last, []() {});
+        }
+
+        jobs->Wait(last);
+        Report("dependency chain", kChain, Seconds(start));
+    }
+
+    {
+        const size_t       kItems = 1 << 24;
+        std::vector<float> values(kItems, 1.0f);
+
+        auto work = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                values[i] = values[i] * 1.0001f + 0.5f;
+            }
+        };
+
+        // Warm up, the first pass pays for page faults
+        work(0, kItems);
+
+        auto start = Clock::now();
+        work(0, kItems);
+        double serial = Seconds(start);
+
+        start = Clock::now();
+        jobs->ParallelFor(kItems, 1 << 16, work);
+        double parallel = Seconds(start);
+
+        printf("%-28s %10.3f ms serial %10.3f ms parallel %6.2fx\n", "ParallelFor 16M floats", serial * 1000.0, parallel * 1000.0, serial / parallel);
+    }
+
+    JobSystem::Destroy();
+    return 0;
+}
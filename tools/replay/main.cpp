@@ -0,0 +1,294 @@
+#include <Exceptions/EstException.h>
+#include <Graphics/CommandCapture.h>
+#include <Graphics/NativeWindow.h>
+#include <Graphics/Renderer.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+/*
+    Plays a capture from Graphics::Renderer::RecordCommands back through a backend and reports timings
+
+    Replay <capture> [--api vulkan|opengl|software] [--repeat N] [--threads N] [--headless]
+
+    "cpu" is BeginFrame to EndFrame, "total" also waits for the frame to finish rendering.
+    "gpu" comes from the backend's timestamps, which trail by the frames in flight, so it is only reported overall.
+*/
+
+using namespace Graphics;
+using namespace Graphics::Backends;
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+    std::string path;
+    API         api = API::Vulkan;
+    uint32_t    repeat = 100;
+    uint32_t    threads = 0;
+    bool        headless = false;
+};
+
+struct Timing
+{
+    uint32_t count = 0;
+    double   cpu = 0.0;
+    double   cpuMax = 0.0;
+    double   total = 0.0;
+    double   totalMax = 0.0;
+};
+
+static bool ParseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool        hasValue = i + 1 < argc;
+
+        if (arg == "--api" && hasValue) {
+            std::string api = argv[++i];
+            if (api == "vulkan") {
+                options.api = API::Vulkan;
+            } else if (api == "opengl") {
+                options.api = API::OpenGL;
+            } else if (api == "software") {
+                options.api = API::Software;
+            } else {
+                return false;
+            }
+        } else if (arg == "--repeat" && hasValue) {
+            options.repeat = (uint32_t)std::max(atoi(argv[++i]), 1);
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = (uint32_t)std::max(atoi(argv[++i]), 0);
+        } else if (arg == "--headless") {
+            options.headless = true;
+        } else if (options.path.empty() && arg.rfind("--", 0) != 0) {
+            options.path = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.path.empty();
+}
+
+static double Milliseconds(Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static void Replay(const Options &options)
+{
+    auto capture = CommandCapture::Read(options.path);
+    if (capture.frames.empty()) {
+        throw Exceptions::EstException("Capture has no frames");
+    }
+
+    auto window = NativeWindow::Get();
+    window->Init("Replay", capture.frames[0].width, capture.frames[0].height, options.api, false, options.headless);
+
+    // Unthrottled, vsync would hide everything below the refresh interval
+    SwapchainInfo swapchain;
+    swapchain.presentMode = PresentMode::Immediate;
+    swapchain.headless = options.headless;
+
+    auto renderer = Renderer::Get();
+    renderer->Init(options.api, {}, VertexFormat::Float, swapchain);
+    renderer->SetRecordThreads(options.threads);
+
+    std::vector<Texture2D *> loaded;
+
+    // Pixels aren't captured, placeholders of the same size keep the sampling cost and opaque classification
+    std::map<uint64_t, const void *> textures;
+    for (auto &[hash, record] : capture.textures) {
+        if (record.width == 0 || record.height == 0) {
+            continue;
+        }
+
+        std::vector<char> pixels((size_t)record.width * record.height * 4, (char)0xFF);
+        if (!record.opaque) {
+            for (size_t i = 3; i < pixels.size(); i += 4) {
+                pixels[i] = (char)0x80;
+            }
+        }
+
+        auto texture = renderer->LoadTexture(pixels.data(), record.width, record.height);
+        loaded.push_back(texture);
+        textures[hash] = texture->GetId();
+    }
+
+    // Images the capture couldn't name, like textures created outside the Renderer
+    const char white[4] = { (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF };
+    auto       fallback = renderer->LoadTexture(white, 1u, 1u);
+    loaded.push_back(fallback);
+
+    std::map<uint64_t, BlendHandle> blends;
+    for (auto &[hash, record] : capture.blends) {
+        blends[hash] = record.builtin ? record.handle : renderer->CreateBlendState(record.info);
+    }
+
+    std::map<RenderTargetHandle, RenderTargetHandle> targets;
+    for (auto &[handle, rect] : capture.targets) {
+        targets[handle] = renderer->CreateRenderTarget(rect);
+    }
+
+    auto target = [&](RenderTargetHandle handle) {
+        auto it = targets.find(handle);
+        return it == targets.end() ? kBackbuffer : it->second;
+    };
+
+    // Resolve everything up front, the timed loop only pushes
+    for (auto &frame : capture.frames) {
+        for (auto &submission : frame.submissions) {
+            auto &info = submission.info;
+
+            auto blend = blends.find(submission.blendHash);
+            info.alphablend = blend != blends.end() ? blend->second : DefaultBlend::BLEND;
+
+            submission.target = target(submission.target);
+
+            if (submission.imageTarget != kBackbuffer) {
+                info.image = renderer->GetRenderTargetImage(target(submission.imageTarget));
+            } else if (info.fragmentType == ShaderFragmentType::Image) {
+                auto texture = textures.find(submission.imageHash);
+                info.image = texture != textures.end() ? texture->second : fallback->GetId();
+            }
+        }
+    }
+
+    std::vector<Timing> timings(capture.frames.size());
+    Timing              gpu;
+
+    for (uint32_t r = 0; r < options.repeat && !window->ShouldExit(); r++) {
+        for (size_t f = 0; f < capture.frames.size(); f++) {
+            window->PumpEvents();
+
+            auto start = Clock::now();
+            if (!renderer->BeginFrame()) {
+                continue;
+            }
+
+            renderer->ImGui_NewFrame();
+            renderer->ImGui_EndFrame();
+
+            RenderTargetHandle current = kBackbuffer;
+            for (auto &submission : capture.frames[f].submissions) {
+                if (submission.target != current) {
+                    current = submission.target;
+                    renderer->SetRenderTarget(current);
+                }
+
+                renderer->Push(submission.info);
+            }
+
+            if (current != kBackbuffer) {
+                renderer->SetRenderTarget(kBackbuffer);
+            }
+
+            renderer->EndFrame();
+            auto recorded = Clock::now();
+
+            renderer->GetBackend()->WaitForPresent();
+            auto finished = Clock::now();
+
+            double cpu = Milliseconds(recorded - start);
+            double total = Milliseconds(finished - start);
+
+            auto &timing = timings[f];
+            timing.count++;
+            timing.cpu += cpu;
+            timing.cpuMax = std::max(timing.cpuMax, cpu);
+            timing.total += total;
+            timing.totalMax = std::max(timing.totalMax, total);
+
+            auto gpuTimings = renderer->GetGpuTimings();
+            if (gpuTimings.valid) {
+                gpu.count++;
+                gpu.total += gpuTimings.total;
+                gpu.totalMax = std::max(gpu.totalMax, gpuTimings.total);
+            }
+        }
+    }
+
+    Timing overall;
+    printf("%-6s %12s %12s %12s %12s %12s\n", "frame", "submissions", "cpu avg", "cpu max", "total avg", "total max");
+
+    for (size_t f = 0; f < timings.size(); f++) {
+        auto &timing = timings[f];
+        if (timing.count == 0) {
+            continue;
+        }
+
+        printf("%-6zu %12zu %12.3f %12.3f %12.3f %12.3f\n",
+               f,
+               capture.frames[f].submissions.size(),
+               timing.cpu / timing.count,
+               timing.cpuMax,
+               timing.total / timing.count,
+               timing.totalMax);
+
+        overall.count += timing.count;
+        overall.cpu += timing.cpu;
+        overall.cpuMax = std::max(overall.cpuMax, timing.cpuMax);
+        overall.total += timing.total;
+        overall.totalMax = std::max(overall.totalMax, timing.totalMax);
+    }
+
+    if (overall.count) {
+        printf("%-6s %12s %12.3f %12.3f %12.3f %12.3f\n",
+               "all",
+               "",
+               overall.cpu / overall.count,
+               overall.cpuMax,
+               overall.total / overall.count,
+               overall.totalMax);
+    }
+
+    if (gpu.count) {
+        printf("gpu avg %.3f ms, max %.3f ms over %u frames\n", gpu.total / gpu.count, gpu.totalMax, gpu.count);
+    } else {
+        printf("gpu timings unavailable\n");
+    }
+
+    for (auto &[handle, created] : targets) {
+        renderer->DestroyRenderTarget(created);
+    }
+
+    for (auto texture : loaded) {
+        delete texture;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        printf("Usage: %s <capture> [--api vulkan|opengl|software] [--repeat N] [--threads N] [--headless]\n", argv[0]);
+        return 1;
+    }
+
+    if (options.headless) {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
+        printf("Failed to initialize SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    int result = 0;
+    try {
+        Replay(options);
+    } catch (Exceptions::EstException &e) {
+        printf("%s\n", e.what());
+        result = 1;
+    }
+
+    Graphics::Renderer::Destroy();
+    Graphics::NativeWindow::Destroy();
+
+    SDL_Quit();
+    return result;
+}